@@ -9,6 +9,8 @@ def configure(env):
 def get_doc_classes():
     return [
         "ManyBoneIK3D",
+        "ManyBoneIK3DServer",
+        "ManyBoneIK3DState",
         "IKBone3D",
         "IKEffector3D",
         "IKBoneSegment3D",
@@ -65,6 +65,7 @@ void ManyBoneIK3DGizmoPlugin::redraw(EditorNode3DGizmo *p_gizmo) {
 	many_bone_ik = Object::cast_to<ManyBoneIK3D>(p_gizmo->get_node_3d());
 	Skeleton3D *skeleton = Object::cast_to<ManyBoneIK3D>(p_gizmo->get_node_3d())->get_skeleton();
 	p_gizmo->clear();
+	redraw_count++;
 	if (!skeleton || !skeleton->get_bone_count()) {
 		current_many_bone_ik_id = ObjectID(); // Reset if no valid skeleton
 		return;
@@ -100,14 +101,8 @@ void ManyBoneIK3DGizmoPlugin::redraw(EditorNode3DGizmo *p_gizmo) {
 
 		Color current_bone_color = (current_bone_idx == selected) ? selected_bone_color : bone_color;
 
-		for (const Ref<IKBoneSegment3D> &segmented_skeleton : many_bone_ik->get_segmented_skeletons()) {
-			if (segmented_skeleton.is_null()) {
-				continue;
-			}
-			Ref<IKBone3D> ik_bone = segmented_skeleton->get_ik_bone(current_bone_idx);
-			if (ik_bone.is_null() || ik_bone->get_constraint().is_null()) {
-				continue;
-			}
+		Ref<IKBone3D> ik_bone = many_bone_ik->find_ik_bone(current_bone_idx);
+		if (ik_bone.is_valid() && ik_bone->get_constraint().is_valid()) {
 			create_gizmo_mesh(current_bone_idx, ik_bone, p_gizmo, current_bone_color, skeleton, many_bone_ik);
 		}
 
@@ -125,6 +120,7 @@ void ManyBoneIK3DGizmoPlugin::redraw(EditorNode3DGizmo *p_gizmo) {
 			bones_to_process.push_back(child_bones_vector[i]);
 		}
 	}
+	_prune_kusudama_materials(new_ik_id);
 }
 
 void ManyBoneIK3DGizmoPlugin::create_gizmo_mesh(BoneId current_bone_idx, Ref<IKBone3D> ik_bone, EditorNode3DGizmo *p_gizmo, Color current_bone_color, Skeleton3D *many_bone_ik_skeleton, ManyBoneIK3D *p_many_bone_ik) {
@@ -136,59 +132,76 @@ void ManyBoneIK3DGizmoPlugin::create_gizmo_mesh(BoneId current_bone_idx, Ref<IKB
 	if (!open_cones.size()) {
 		return;
 	}
+	if (current_bone_idx < 0 || current_bone_idx >= many_bone_ik_skeleton->get_bone_count()) {
+		return;
+	}
 	BoneId parent_idx = many_bone_ik_skeleton->get_bone_parent(current_bone_idx);
-	LocalVector<int> bones;
-	LocalVector<float> weights;
-	bones.resize(4);
-	weights.resize(4);
-	for (int i = 0; i < 4; i++) {
-		bones[i] = 0;
-		weights[i] = 0;
+	if (parent_idx <= -1 || parent_idx >= many_bone_ik_skeleton->get_bone_count()) {
+		return;
+	}
+	Ref<ArrayMesh> mesh = _get_kusudama_mesh();
+	if (mesh.is_null()) {
+		return;
 	}
-	bones[0] = parent_idx;
-	weights[0] = 1;
 
 	Transform3D constraint_relative_to_the_skeleton = p_many_bone_ik->get_relative_transform(p_many_bone_ik->get_owner()).affine_inverse() * many_bone_ik_skeleton->get_relative_transform(many_bone_ik_skeleton->get_owner()) * p_many_bone_ik->get_godot_skeleton_transform_inverse() * ik_bone->get_constraint_orientation_transform()->get_global_transform();
 	PackedFloat32Array kusudama_open_cones;
-	Ref<IKKusudama3D> kusudama = ik_bone->get_constraint();
+	kusudama_open_cones.resize(open_cones.size() * 4 * 3);
+	kusudama_open_cones.fill(0.0f);
+	float *cone_data = kusudama_open_cones.ptrw();
 	for (int32_t cone_i = 0; cone_i < open_cones.size(); cone_i++) {
 		Ref<IKLimitCone3D> open_cone = open_cones[cone_i];
 		Vector3 control_point = open_cone->get_control_point();
-		PackedFloat32Array new_kusudama_open_cones;
-		new_kusudama_open_cones.resize(4 * 3);
-		new_kusudama_open_cones.fill(0.0f);
-		new_kusudama_open_cones.write[0] = control_point.x;
-		new_kusudama_open_cones.write[1] = control_point.y;
-		new_kusudama_open_cones.write[2] = control_point.z;
-		float radius = open_cone->get_radius();
-		new_kusudama_open_cones.write[3] = radius;
+		cone_data[0] = control_point.x;
+		cone_data[1] = control_point.y;
+		cone_data[2] = control_point.z;
+		cone_data[3] = open_cone->get_radius();
 
 		Vector3 tangent_center_1 = open_cone->get_tangent_circle_center_next_1();
-		new_kusudama_open_cones.write[4] = tangent_center_1.x;
-		new_kusudama_open_cones.write[5] = tangent_center_1.y;
-		new_kusudama_open_cones.write[6] = tangent_center_1.z;
 		float tangent_radius = open_cone->get_tangent_circle_radius_next();
-		new_kusudama_open_cones.write[7] = tangent_radius;
+		cone_data[4] = tangent_center_1.x;
+		cone_data[5] = tangent_center_1.y;
+		cone_data[6] = tangent_center_1.z;
+		cone_data[7] = tangent_radius;
 
 		Vector3 tangent_center_2 = open_cone->get_tangent_circle_center_next_2();
-		new_kusudama_open_cones.write[8] = tangent_center_2.x;
-		new_kusudama_open_cones.write[9] = tangent_center_2.y;
-		new_kusudama_open_cones.write[10] = tangent_center_2.z;
-		new_kusudama_open_cones.write[11] = tangent_radius;
-
-		kusudama_open_cones.append_array(new_kusudama_open_cones);
-	}
-	if (current_bone_idx >= many_bone_ik_skeleton->get_bone_count()) {
-		return;
-	}
-	if (current_bone_idx == -1) {
-		return;
-	}
-	if (parent_idx >= many_bone_ik_skeleton->get_bone_count()) {
-		return;
+		cone_data[8] = tangent_center_2.x;
+		cone_data[9] = tangent_center_2.y;
+		cone_data[10] = tangent_center_2.z;
+		cone_data[11] = tangent_radius;
+		cone_data += 4 * 3;
+	}
+
+	// The material of a bone is kept across redraws, and its uniforms are only pushed when the cones or the color changed.
+	KusudamaMaterial &cached = kusudama_materials[p_many_bone_ik->get_instance_id()][current_bone_idx];
+	if (cached.material.is_null()) {
+		cached.material.instantiate();
+		cached.material->set_shader(kusudama_shader);
+		cached.material->set_shader_parameter("cone_sequence", kusudama_open_cones);
+		cached.material->set_shader_parameter("cone_count", open_cones.size());
+		cached.material->set_shader_parameter("kusudama_color", current_bone_color);
+		cached.cone_sequence = kusudama_open_cones;
+		cached.color = current_bone_color;
+	} else {
+		if (cached.cone_sequence != kusudama_open_cones) {
+			cached.material->set_shader_parameter("cone_sequence", kusudama_open_cones);
+			if (cached.cone_sequence.size() != kusudama_open_cones.size()) {
+				cached.material->set_shader_parameter("cone_count", open_cones.size());
+			}
+			cached.cone_sequence = kusudama_open_cones;
+		}
+		if (cached.color != current_bone_color) {
+			cached.material->set_shader_parameter("kusudama_color", current_bone_color);
+			cached.color = current_bone_color;
+		}
 	}
-	if (parent_idx <= -1) {
-		return;
+	cached.redraw = redraw_count;
+	p_gizmo->add_mesh(mesh, cached.material, constraint_relative_to_the_skeleton);
+}
+
+Ref<ArrayMesh> ManyBoneIK3DGizmoPlugin::_get_kusudama_mesh() {
+	if (kusudama_mesh.is_valid()) {
+		return kusudama_mesh;
 	}
 	// Code copied from the SphereMesh.
 	int rings = 8;
@@ -240,7 +253,7 @@ void ManyBoneIK3DGizmoPlugin::create_gizmo_mesh(BoneId current_bone_idx, Ref<IKB
 		thisrow = point;
 	}
 	if (!indices.size()) {
-		return;
+		return kusudama_mesh;
 	}
 	Ref<SurfaceTool> surface_tool;
 	surface_tool.instantiate();
@@ -248,8 +261,6 @@ void ManyBoneIK3DGizmoPlugin::create_gizmo_mesh(BoneId current_bone_idx, Ref<IKB
 	const int32_t MESH_CUSTOM_0 = 0;
 	surface_tool->set_custom_format(MESH_CUSTOM_0, SurfaceTool::CustomFormat::CUSTOM_RGBA_HALF);
 	for (int32_t point_i = 0; point_i < points.size(); point_i++) {
-		surface_tool->set_bones(bones);
-		surface_tool->set_weights(weights);
 		Color c;
 		c.r = normals[point_i].x;
 		c.g = normals[point_i].y;
@@ -262,16 +273,33 @@ void ManyBoneIK3DGizmoPlugin::create_gizmo_mesh(BoneId current_bone_idx, Ref<IKB
 	for (int32_t index_i : indices) {
 		surface_tool->add_index(index_i);
 	}
-	Ref<ShaderMaterial> kusudama_material;
-	kusudama_material.instantiate();
-	kusudama_material->set_shader(kusudama_shader);
-	kusudama_material->set_shader_parameter("cone_sequence", kusudama_open_cones);
-	int32_t cone_count = kusudama->get_open_cones().size();
-	kusudama_material->set_shader_parameter("cone_count", cone_count);
-	kusudama_material->set_shader_parameter("kusudama_color", current_bone_color);
-	p_gizmo->add_mesh(
-			surface_tool->commit(Ref<Mesh>(), RS::ARRAY_CUSTOM_RGBA_HALF << RS::ARRAY_FORMAT_CUSTOM0_SHIFT),
-			kusudama_material, constraint_relative_to_the_skeleton);
+	kusudama_mesh = surface_tool->commit(Ref<ArrayMesh>(), RS::ARRAY_CUSTOM_RGBA_HALF << RS::ARRAY_FORMAT_CUSTOM0_SHIFT);
+	return kusudama_mesh;
+}
+
+void ManyBoneIK3DGizmoPlugin::_prune_kusudama_materials(ObjectID p_many_bone_ik) {
+	// Drops the materials of bones that lost their constraint, and of nodes that no longer exist.
+	HashMap<ObjectID, HashMap<BoneId, KusudamaMaterial>>::Iterator node_materials = kusudama_materials.find(p_many_bone_ik);
+	if (node_materials) {
+		LocalVector<BoneId> stale_bones;
+		for (const KeyValue<BoneId, KusudamaMaterial> &E : node_materials->value) {
+			if (E.value.redraw != redraw_count) {
+				stale_bones.push_back(E.key);
+			}
+		}
+		for (BoneId bone : stale_bones) {
+			node_materials->value.erase(bone);
+		}
+	}
+	LocalVector<ObjectID> stale_nodes;
+	for (const KeyValue<ObjectID, HashMap<BoneId, KusudamaMaterial>> &E : kusudama_materials) {
+		if (!ObjectDB::get_instance(E.key)) {
+			stale_nodes.push_back(E.key);
+		}
+	}
+	for (ObjectID node : stale_nodes) {
+		kusudama_materials.erase(node);
+	}
 }
 
 int32_t ManyBoneIK3DGizmoPlugin::get_priority() const {
@@ -284,6 +312,23 @@ EditorPluginManyBoneIK::EditorPluginManyBoneIK() {
 	Node3DEditor::get_singleton()->add_gizmo_plugin(many_bone_ik_gizmo_plugin);
 }
 
+bool EditorPluginManyBoneIK::handles(Object *p_object) const {
+	return Object::cast_to<ManyBoneIK3D>(p_object) != nullptr;
+}
+
+void EditorPluginManyBoneIK::edit(Object *p_object) {
+	// Only the edited node redraws its gizmo while solving, at its own gizmo_update_rate.
+	ManyBoneIK3D *previous = Object::cast_to<ManyBoneIK3D>(ObjectDB::get_instance(edited_many_bone_ik_id));
+	if (previous) {
+		previous->set_gizmo_redraw_enabled(false);
+	}
+	ManyBoneIK3D *many_bone_ik_3d = Object::cast_to<ManyBoneIK3D>(p_object);
+	edited_many_bone_ik_id = many_bone_ik_3d ? many_bone_ik_3d->get_instance_id() : ObjectID();
+	if (many_bone_ik_3d) {
+		many_bone_ik_3d->set_gizmo_redraw_enabled(true);
+	}
+}
+
 int ManyBoneIK3DGizmoPlugin::subgizmos_intersect_ray(const EditorNode3DGizmo *p_gizmo, Camera3D *p_camera, const Vector2 &p_point) const {
 	Skeleton3D *skeleton = Object::cast_to<ManyBoneIK3D>(p_gizmo->get_node_3d())->get_skeleton();
 	ERR_FAIL_COND_V(!skeleton, -1);
@@ -33,6 +33,7 @@
 #include "../src/ik_bone_3d.h"
 #include "../src/many_bone_ik_3d.h"
 
+#include "core/templates/hash_map.h"
 #include "editor/editor_inspector.h"
 #include "editor/editor_settings.h"
 #include "editor/plugins/skeleton_3d_editor_plugin.h"
@@ -51,6 +52,16 @@ class Button;
 class ManyBoneIK3DGizmoPlugin : public EditorNode3DGizmoPlugin {
 	GDCLASS(ManyBoneIK3DGizmoPlugin, EditorNode3DGizmoPlugin);
 	Ref<Shader> kusudama_shader = memnew(Shader);
+	// Every kusudama is drawn with the same sphere; only its material and transform are per bone.
+	Ref<ArrayMesh> kusudama_mesh;
+	struct KusudamaMaterial {
+		Ref<ShaderMaterial> material;
+		PackedFloat32Array cone_sequence;
+		Color color;
+		uint64_t redraw = 0;
+	};
+	HashMap<ObjectID, HashMap<BoneId, KusudamaMaterial>> kusudama_materials;
+	uint64_t redraw_count = 0;
 
 	Ref<StandardMaterial3D> unselected_mat;
 	Ref<ShaderMaterial> selected_mat;
@@ -69,6 +80,8 @@ class ManyBoneIK3DGizmoPlugin : public EditorNode3DGizmoPlugin {
 protected:
 	static void _bind_methods();
 	void _notifications(int32_t p_what);
+	Ref<ArrayMesh> _get_kusudama_mesh();
+	void _prune_kusudama_materials(ObjectID p_many_bone_ik);
 
 public:
 	ManyBoneIK3DGizmoPlugin();
@@ -96,6 +109,10 @@ public:
 class EditorPluginManyBoneIK : public EditorPlugin {
 	GDCLASS(EditorPluginManyBoneIK, EditorPlugin);
 
+	ObjectID edited_many_bone_ik_id;
+
 public:
+	virtual bool handles(Object *p_object) const override;
+	virtual void edit(Object *p_object) override;
 	EditorPluginManyBoneIK();
 };
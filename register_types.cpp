@@ -35,13 +35,21 @@
 #include "src/ik_effector_template_3d.h"
 #include "src/ik_kusudama_3d.h"
 #include "src/many_bone_ik_3d.h"
+#include "src/many_bone_ik_3d_server.h"
+#include "src/many_bone_ik_3d_state.h"
+
+#include "core/config/engine.h"
 
 #ifdef TOOLS_ENABLED
 #include "editor/many_bone_ik_3d_gizmo_plugin.h"
 #endif
 
+static ManyBoneIK3DServer *many_bone_ik_3d_server = nullptr;
+
 void initialize_many_bone_ik_module(ModuleInitializationLevel p_level) {
 	if (p_level == MODULE_INITIALIZATION_LEVEL_SCENE) {
+		many_bone_ik_3d_server = memnew(ManyBoneIK3DServer);
+		Engine::get_singleton()->add_singleton(Engine::Singleton("ManyBoneIK3DServer", ManyBoneIK3DServer::get_singleton()));
 	}
 #ifdef TOOLS_ENABLED
 	if (p_level == MODULE_INITIALIZATION_LEVEL_EDITOR) {
@@ -51,6 +59,7 @@ void initialize_many_bone_ik_module(ModuleInitializationLevel p_level) {
 	if (p_level == MODULE_INITIALIZATION_LEVEL_SERVERS) {
 		GDREGISTER_CLASS(IKEffectorTemplate3D);
 		GDREGISTER_CLASS(ManyBoneIK3D);
+		GDREGISTER_CLASS(ManyBoneIK3DState);
 		GDREGISTER_CLASS(IKBone3D);
 		GDREGISTER_CLASS(IKNode3D);
 		GDREGISTER_CLASS(IKEffector3D);
@@ -58,6 +67,7 @@ void initialize_many_bone_ik_module(ModuleInitializationLevel p_level) {
 		GDREGISTER_CLASS(IKKusudama3D);
 		GDREGISTER_CLASS(IKRay3D);
 		GDREGISTER_CLASS(IKLimitCone3D);
+		GDREGISTER_ABSTRACT_CLASS(ManyBoneIK3DServer);
 	}
 }
 
@@ -65,4 +75,9 @@ void uninitialize_many_bone_ik_module(ModuleInitializationLevel p_level) {
 	if (p_level != MODULE_INITIALIZATION_LEVEL_SCENE) {
 		return;
 	}
+	if (many_bone_ik_3d_server) {
+		Engine::get_singleton()->remove_singleton("ManyBoneIK3DServer");
+		memdelete(many_bone_ik_3d_server);
+		many_bone_ik_3d_server = nullptr;
+	}
 }
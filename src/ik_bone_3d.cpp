@@ -34,6 +34,57 @@
 #include "math/ik_node_3d.h"
 #include <cmath>
 
+void IKSkeletonSnapshot3D::capture(Skeleton3D *p_skeleton) {
+	clear();
+	ERR_FAIL_NULL(p_skeleton);
+	const int32_t bone_count = p_skeleton->get_bone_count();
+	bone_names.resize(bone_count);
+	bone_parents.resize(bone_count);
+	bone_children.resize(bone_count);
+	bone_poses.resize(bone_count);
+	bone_global_poses.resize(bone_count);
+	for (int32_t bone_i = 0; bone_i < bone_count; bone_i++) {
+		bone_names.write[bone_i] = p_skeleton->get_bone_name(bone_i);
+		bone_indices[bone_names[bone_i]] = bone_i;
+		bone_parents[bone_i] = p_skeleton->get_bone_parent(bone_i);
+		bone_children[bone_i] = p_skeleton->get_bone_children(bone_i);
+		bone_poses[bone_i] = p_skeleton->get_bone_pose(bone_i);
+		bone_global_poses[bone_i] = p_skeleton->get_bone_global_pose(bone_i);
+	}
+	parentless_bones = p_skeleton->get_parentless_bones();
+}
+
+void IKSkeletonSnapshot3D::clear() {
+	bone_names.clear();
+	bone_indices.clear();
+	bone_parents.clear();
+	bone_children.clear();
+	bone_poses.clear();
+	bone_global_poses.clear();
+	parentless_bones.clear();
+}
+
+BoneId IKSkeletonSnapshot3D::find_bone(const String &p_name) const {
+	const BoneId *bone = bone_indices.getptr(p_name);
+	return bone ? *bone : -1;
+}
+
+String IKSkeletonSnapshot3D::get_bone_name(BoneId p_bone) const {
+	ERR_FAIL_INDEX_V(p_bone, bone_names.size(), String());
+	return bone_names[p_bone];
+}
+
+BoneId IKSkeletonSnapshot3D::get_bone_parent(BoneId p_bone) const {
+	ERR_FAIL_INDEX_V(p_bone, int32_t(bone_parents.size()), -1);
+	return bone_parents[p_bone];
+}
+
+const Vector<BoneId> &IKSkeletonSnapshot3D::get_bone_children(BoneId p_bone) const {
+	static const Vector<BoneId> no_children;
+	ERR_FAIL_INDEX_V(p_bone, int32_t(bone_children.size()), no_children);
+	return bone_children[p_bone];
+}
+
 void IKBone3D::set_bone_id(BoneId p_bone_id, Skeleton3D *p_skeleton) {
 	ERR_FAIL_NULL(p_skeleton);
 	bone_id = p_bone_id;
@@ -54,7 +105,7 @@ void IKBone3D::set_parent(const Ref<IKBone3D> &p_parent) {
 	}
 }
 
-void IKBone3D::update_default_bone_direction_transform(Skeleton3D *p_skeleton) {
+void IKBone3D::update_default_bone_direction_transform(const IKSkeletonSnapshot3D *p_skeleton) {
 	Vector3 child_centroid;
 	int child_count = 0;
 
@@ -66,9 +117,9 @@ void IKBone3D::update_default_bone_direction_transform(Skeleton3D *p_skeleton) {
 	if (child_count > 0) {
 		child_centroid /= child_count;
 	} else {
-		const PackedInt32Array &bone_children = p_skeleton->get_bone_children(bone_id);
+		const Vector<BoneId> &bone_children = p_skeleton->get_bone_children(bone_id);
 		for (BoneId child_bone_idx : bone_children) {
-			child_centroid += p_skeleton->get_bone_global_pose(child_bone_idx).origin;
+			child_centroid += p_skeleton->bone_global_poses[child_bone_idx].origin;
 		}
 		child_centroid /= bone_children.size();
 	}
@@ -195,8 +246,7 @@ void IKBone3D::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("get_constraint_twist_transform"), &IKBone3D::get_constraint_twist_transform);
 }
 
-IKBone3D::IKBone3D(StringName p_bone, Skeleton3D *p_skeleton, const Ref<IKBone3D> &p_parent, Vector<Ref<IKEffectorTemplate3D>> &p_pins, float p_default_dampening,
-		ManyBoneIK3D *p_many_bone_ik) {
+IKBone3D::IKBone3D(StringName p_bone, const IKSkeletonSnapshot3D *p_skeleton, const Ref<IKBone3D> &p_parent, Vector<Ref<IKEffectorTemplate3D>> &p_pins, float p_default_dampening) {
 	ERR_FAIL_NULL(p_skeleton);
 
 	default_dampening = p_default_dampening;
@@ -213,7 +263,7 @@ IKBone3D::IKBone3D(StringName p_bone, Skeleton3D *p_skeleton, const Ref<IKBone3D
 		if (elem->get_name() == p_bone) {
 			create_pin();
 			Ref<IKEffector3D> effector = get_pin();
-			effector->set_target_node(p_skeleton, elem->get_target_node());
+			effector->target_node_path = elem->get_target_node();
 			effector->set_motion_propagation_factor(elem->get_motion_propagation_factor());
 			effector->set_weight(elem->get_weight());
 			effector->set_direction_priorities(elem->get_direction_priorities());
@@ -224,7 +274,7 @@ IKBone3D::IKBone3D(StringName p_bone, Skeleton3D *p_skeleton, const Ref<IKBone3D
 
 	float predamp = 1.0 - get_stiffness();
 	dampening = get_parent().is_null() ? Math::PI : predamp * p_default_dampening;
-	float iterations = p_many_bone_ik->get_iterations_per_frame();
+	float iterations = p_skeleton->iterations_per_frame;
 	if (get_constraint().is_null()) {
 		Ref<IKKusudama3D> new_constraint;
 		new_constraint.instantiate();
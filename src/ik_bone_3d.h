@@ -37,12 +37,36 @@
 
 #include "core/io/resource.h"
 #include "core/object/ref_counted.h"
+#include "core/templates/hash_map.h"
+#include "core/templates/local_vector.h"
 #include "scene/3d/skeleton_3d.h"
 
 class IKEffector3D;
 class ManyBoneIK3D;
 class IKBone3D;
 
+// The skeleton data and node settings a bone graph is generated from. It is captured on the main thread,
+// so the graph can be generated on a worker without reading the skeleton or the node.
+struct IKSkeletonSnapshot3D {
+	Vector<String> bone_names;
+	HashMap<String, BoneId> bone_indices;
+	LocalVector<BoneId> bone_parents;
+	LocalVector<Vector<BoneId>> bone_children;
+	LocalVector<Transform3D> bone_poses;
+	LocalVector<Transform3D> bone_global_poses;
+	Vector<BoneId> parentless_bones;
+	float default_damp = Math::PI;
+	int32_t iterations_per_frame = 0;
+
+	void capture(Skeleton3D *p_skeleton);
+	void clear();
+	int32_t get_bone_count() const { return bone_names.size(); }
+	BoneId find_bone(const String &p_name) const;
+	String get_bone_name(BoneId p_bone) const;
+	BoneId get_bone_parent(BoneId p_bone) const;
+	const Vector<BoneId> &get_bone_children(BoneId p_bone) const;
+};
+
 class IKBone3D : public Resource {
 	GDCLASS(IKBone3D, Resource);
 
@@ -85,7 +109,7 @@ public:
 	Transform3D get_bone_direction_global_pose() const;
 	Ref<IKNode3D> get_bone_direction_transform();
 	void set_bone_direction_transform(Ref<IKNode3D> p_bone_direction);
-	void update_default_bone_direction_transform(Skeleton3D *p_skeleton);
+	void update_default_bone_direction_transform(const IKSkeletonSnapshot3D *p_skeleton);
 	void set_constraint_orientation_transform(Ref<IKNode3D> p_transform);
 	Ref<IKNode3D> get_constraint_orientation_transform();
 	Ref<IKNode3D> get_constraint_twist_transform();
@@ -108,7 +132,7 @@ public:
 	bool is_pinned() const;
 	Ref<IKNode3D> get_ik_transform();
 	IKBone3D() {}
-	IKBone3D(StringName p_bone, Skeleton3D *p_skeleton, const Ref<IKBone3D> &p_parent, Vector<Ref<IKEffectorTemplate3D>> &p_pins, float p_default_dampening = Math::PI, ManyBoneIK3D *p_many_bone_ik = nullptr);
+	IKBone3D(StringName p_bone, const IKSkeletonSnapshot3D *p_skeleton, const Ref<IKBone3D> &p_parent, Vector<Ref<IKEffectorTemplate3D>> &p_pins, float p_default_dampening = Math::PI);
 	~IKBone3D() {}
 	float get_cos_half_dampen() const;
 	void set_cos_half_dampen(float p_cos_half_dampen);
@@ -87,13 +87,6 @@ void IKBoneSegment3D::update_pinned_list(Vector<Vector<double>> &r_weights) {
 	}
 }
 
-void IKBoneSegment3D::_update_optimal_rotation(Ref<IKBone3D> p_for_bone, double p_damp, bool p_translate, bool p_constraint_mode, int32_t current_iteration, int32_t total_iterations) {
-	ERR_FAIL_COND(p_for_bone.is_null());
-	_update_target_headings(p_for_bone, &heading_weights, &target_headings);
-	_update_tip_headings(p_for_bone, &tip_headings);
-	_set_optimal_rotation(p_for_bone, &tip_headings, &target_headings, &heading_weights, p_damp, p_translate, p_constraint_mode);
-}
-
 Quaternion IKBoneSegment3D::clamp_to_cos_half_angle(Quaternion p_quat, double p_cos_half_angle) {
 	if (p_quat.w < 0.0) {
 		p_quat = p_quat * -1;
@@ -111,145 +104,17 @@ Quaternion IKBoneSegment3D::clamp_to_cos_half_angle(Quaternion p_quat, double p_
 	return p_quat;
 }
 
-float IKBoneSegment3D::_get_manual_msd(const PackedVector3Array &r_htip, const PackedVector3Array &r_htarget, const Vector<double> &p_weights) {
-	float manual_RMSD = 0.0f;
-	float w_sum = 0.0f;
-	for (int i = 0; i < r_htarget.size(); i++) {
-		float x_d = r_htarget[i].x - r_htip[i].x;
-		float y_d = r_htarget[i].y - r_htip[i].y;
-		float z_d = r_htarget[i].z - r_htip[i].z;
-		float mag_sq = p_weights[i] * (x_d * x_d + y_d * y_d + z_d * z_d);
-		manual_RMSD += mag_sq;
-		w_sum += p_weights[i];
-	}
-	manual_RMSD /= w_sum * w_sum;
-	return manual_RMSD;
-}
-
-void IKBoneSegment3D::_set_optimal_rotation(Ref<IKBone3D> p_for_bone, PackedVector3Array *r_htip, PackedVector3Array *r_htarget, Vector<double> *r_weights, float p_dampening, bool p_translate, bool p_constraint_mode, double current_iteration, double total_iterations) {
-	ERR_FAIL_COND(p_for_bone.is_null());
-	ERR_FAIL_NULL(r_htip);
-	ERR_FAIL_NULL(r_htarget);
-	ERR_FAIL_NULL(r_weights);
-
-	_update_target_headings(p_for_bone, &heading_weights, &target_headings);
-	Transform3D prev_transform = p_for_bone->get_pose();
-	bool got_closer = true;
-	double bone_damp = p_for_bone->get_cos_half_dampen();
-	int i = 0;
-	do {
-		_update_tip_headings(p_for_bone, &tip_headings);
-		if (!p_constraint_mode) {
-			Array superpose_result = QuaternionCharacteristicPolynomial::weighted_superpose(*r_htip, *r_htarget, *r_weights, p_translate, evec_prec);
-			Quaternion rotation = superpose_result[0];
-			Vector3 translation = superpose_result[1];
-			double dampening = (p_dampening != -1.0) ? p_dampening : bone_damp;
-			rotation = clamp_to_cos_half_angle(rotation, cos(dampening / 2.0));
-			if (current_iteration == 0) {
-				current_iteration = 0.0001;
-			}
-			rotation = rotation.slerp(p_for_bone->get_global_pose().basis.get_rotation_quaternion(), static_cast<double>(total_iterations) / current_iteration);
-			p_for_bone->get_ik_transform()->rotate_local_with_global(rotation);
-			Transform3D result = Transform3D(p_for_bone->get_global_pose().basis, p_for_bone->get_global_pose().origin + translation);
-			p_for_bone->set_global_pose(result);
-		}
-		bool is_parent_valid = p_for_bone->get_parent().is_valid();
-		if (is_parent_valid && p_for_bone->is_orientationally_constrained()) {
-			p_for_bone->get_constraint()->snap_to_orientation_limit(p_for_bone->get_bone_direction_transform(), p_for_bone->get_ik_transform(), p_for_bone->get_constraint_orientation_transform(), bone_damp, p_for_bone->get_cos_half_dampen());
-		}
-		if (is_parent_valid && p_for_bone->is_axially_constrained()) {
-			p_for_bone->get_constraint()->set_snap_to_twist_limit(p_for_bone->get_bone_direction_transform(), p_for_bone->get_ik_transform(), p_for_bone->get_constraint_twist_transform(), bone_damp, p_for_bone->get_cos_half_dampen());
-		}
-		if (default_stabilizing_pass_count > 0) {
-			_update_tip_headings(p_for_bone, &tip_headings_uniform);
-			double current_msd = _get_manual_msd(tip_headings_uniform, target_headings, heading_weights);
-			if (current_msd <= previous_deviation * 1.0001) {
-				previous_deviation = current_msd;
-				got_closer = true;
-				break;
-			} else {
-				got_closer = false;
-				p_for_bone->set_pose(prev_transform);
-			}
-		}
-		i++;
-	} while (i < default_stabilizing_pass_count && !got_closer);
-
-	if (root == p_for_bone) {
-		previous_deviation = INFINITY;
-	}
-}
-
-void IKBoneSegment3D::_update_target_headings(Ref<IKBone3D> p_for_bone, Vector<double> *r_weights, PackedVector3Array *r_target_headings) {
-	ERR_FAIL_COND(p_for_bone.is_null());
-	ERR_FAIL_NULL(r_weights);
-	ERR_FAIL_NULL(r_target_headings);
-	int32_t last_index = 0;
-	for (int32_t effector_i = 0; effector_i < effector_list.size(); effector_i++) {
-		Ref<IKEffector3D> effector = effector_list[effector_i];
-		if (effector.is_null()) {
-			continue;
-		}
-		last_index = effector->update_effector_target_headings(r_target_headings, last_index, p_for_bone, &heading_weights);
-	}
-}
-
-void IKBoneSegment3D::_update_tip_headings(Ref<IKBone3D> p_for_bone, PackedVector3Array *r_heading_tip) {
-	ERR_FAIL_NULL(r_heading_tip);
-	ERR_FAIL_COND(p_for_bone.is_null());
-	int32_t last_index = 0;
-	for (int32_t effector_i = 0; effector_i < effector_list.size(); effector_i++) {
-		Ref<IKEffector3D> effector = effector_list[effector_i];
-		if (effector.is_null()) {
-			continue;
-		}
-		last_index = effector->update_effector_tip_headings(r_heading_tip, last_index, p_for_bone);
-	}
-}
-
-void IKBoneSegment3D::segment_solver(const Vector<float> &p_damp, float p_default_damp, bool p_constraint_mode, int32_t p_current_iteration, int32_t p_total_iteration) {
-	for (Ref<IKBoneSegment3D> child : child_segments) {
-		if (child.is_null()) {
-			continue;
-		}
-		child->segment_solver(p_damp, p_default_damp, p_constraint_mode, p_current_iteration, p_total_iteration);
-	}
-	bool is_translate = parent_segment.is_null();
-	if (is_translate) {
-		Vector<float> damp = p_damp;
-		damp.fill(Math::PI);
-		_qcp_solver(damp, Math::PI, is_translate, p_constraint_mode, p_current_iteration, p_total_iteration);
-		return;
-	}
-	_qcp_solver(p_damp, p_default_damp, is_translate, p_constraint_mode, p_current_iteration, p_total_iteration);
-}
-
-void IKBoneSegment3D::_qcp_solver(const Vector<float> &p_damp, float p_default_damp, bool p_translate, bool p_constraint_mode, int32_t p_current_iteration, int32_t p_total_iterations) {
-	for (Ref<IKBone3D> current_bone : bones) {
-		float damp = p_default_damp;
-		bool is_valid_access = !(unlikely((p_damp.size()) < 0 || (current_bone->get_bone_id()) >= (p_damp.size())));
-		if (is_valid_access) {
-			damp = p_damp[current_bone->get_bone_id()];
-		}
-		bool is_non_default_damp = p_default_damp < damp;
-		if (is_non_default_damp) {
-			damp = p_default_damp;
-		}
-		_update_optimal_rotation(current_bone, damp, p_translate, p_constraint_mode, p_current_iteration, p_total_iterations);
-	}
-}
-
 void IKBoneSegment3D::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("is_pinned"), &IKBoneSegment3D::is_pinned);
 	ClassDB::bind_method(D_METHOD("get_ik_bone", "bone"), &IKBoneSegment3D::get_ik_bone);
 }
 
-IKBoneSegment3D::IKBoneSegment3D(Skeleton3D *p_skeleton, StringName p_root_bone_name, Vector<Ref<IKEffectorTemplate3D>> &p_pins, ManyBoneIK3D *p_many_bone_ik, const Ref<IKBoneSegment3D> &p_parent,
+IKBoneSegment3D::IKBoneSegment3D(const IKSkeletonSnapshot3D *p_skeleton, StringName p_root_bone_name, Vector<Ref<IKEffectorTemplate3D>> &p_pins, const Ref<IKBoneSegment3D> &p_parent,
 		BoneId p_root, BoneId p_tip, int32_t p_stabilizing_pass_count) {
 	root = p_root;
 	tip = p_tip;
 	skeleton = p_skeleton;
-	root = Ref<IKBone3D>(memnew(IKBone3D(p_root_bone_name, p_skeleton, p_parent, p_pins, Math::PI, p_many_bone_ik)));
+	root = Ref<IKBone3D>(memnew(IKBone3D(p_root_bone_name, p_skeleton, p_parent, p_pins, Math::PI)));
 	if (p_parent.is_valid()) {
 		root_segment = p_parent->root_segment;
 	} else {
@@ -290,17 +155,11 @@ void IKBoneSegment3D::create_headings_arrays() {
 	for (int32_t bone_i = 0; bone_i < new_pinned_bones.size(); bone_i++) {
 		pinned_bones.write[bone_i] = new_pinned_bones[bone_i];
 	}
-	target_headings.resize(total_headings);
-	tip_headings.resize(total_headings);
-	tip_headings_uniform.resize(total_headings);
 	heading_weights.resize(total_headings);
 	int currentHeading = 0;
 	for (const Vector<double> &current_penalty_array : penalty_array) {
 		for (double ad : current_penalty_array) {
 			heading_weights.write[currentHeading] = ad;
-			target_headings.write[currentHeading] = Vector3();
-			tip_headings.write[currentHeading] = Vector3();
-			tip_headings_uniform.write[currentHeading] = Vector3();
 			currentHeading++;
 		}
 	}
@@ -349,7 +208,7 @@ void IKBoneSegment3D::recursive_create_headings_arrays_for(Ref<IKBoneSegment3D>
 	}
 }
 
-void IKBoneSegment3D::generate_default_segments(Vector<Ref<IKEffectorTemplate3D>> &p_pins, BoneId p_root_bone, BoneId p_tip_bone, ManyBoneIK3D *p_many_bone_ik) {
+void IKBoneSegment3D::generate_default_segments(Vector<Ref<IKEffectorTemplate3D>> &p_pins, BoneId p_root_bone, BoneId p_tip_bone) {
 	Ref<IKBone3D> current_tip = root;
 	Vector<BoneId> children;
 
@@ -357,11 +216,11 @@ void IKBoneSegment3D::generate_default_segments(Vector<Ref<IKEffectorTemplate3D>
 		children = skeleton->get_bone_children(current_tip->get_bone_id());
 
 		if (children.is_empty() || _has_multiple_children_or_pinned(children, current_tip)) {
-			_process_children(children, current_tip, p_pins, p_root_bone, p_tip_bone, p_many_bone_ik);
+			_process_children(children, current_tip, p_pins, p_root_bone, p_tip_bone);
 			break;
 		} else {
 			Vector<BoneId>::Iterator bone_id_iterator = children.begin();
-			current_tip = _create_next_bone(*bone_id_iterator, current_tip, p_pins, p_many_bone_ik);
+			current_tip = _create_next_bone(*bone_id_iterator, current_tip, p_pins);
 		}
 	}
 
@@ -376,16 +235,16 @@ bool IKBoneSegment3D::_has_multiple_children_or_pinned(Vector<BoneId> &r_childre
 	return r_children.size() > 1 || p_current_tip->is_pinned();
 }
 
-void IKBoneSegment3D::_process_children(Vector<BoneId> &r_children, Ref<IKBone3D> p_current_tip, Vector<Ref<IKEffectorTemplate3D>> &r_pins, BoneId p_root_bone, BoneId p_tip_bone, ManyBoneIK3D *p_many_bone_ik) {
+void IKBoneSegment3D::_process_children(Vector<BoneId> &r_children, Ref<IKBone3D> p_current_tip, Vector<Ref<IKEffectorTemplate3D>> &r_pins, BoneId p_root_bone, BoneId p_tip_bone) {
 	tip = p_current_tip;
 	Ref<IKBoneSegment3D> parent(this);
 
 	for (int32_t child_i = 0; child_i < r_children.size(); child_i++) {
 		BoneId child_bone = r_children[child_i];
 		String child_name = skeleton->get_bone_name(child_bone);
-		Ref<IKBoneSegment3D> child_segment = _create_child_segment(child_name, r_pins, p_root_bone, p_tip_bone, p_many_bone_ik, parent);
+		Ref<IKBoneSegment3D> child_segment = _create_child_segment(child_name, r_pins, p_root_bone, p_tip_bone, parent);
 
-		child_segment->generate_default_segments(r_pins, p_root_bone, p_tip_bone, p_many_bone_ik);
+		child_segment->generate_default_segments(r_pins, p_root_bone, p_tip_bone);
 
 		if (child_segment->_has_pinned_descendants()) {
 			_enable_pinned_descendants();
@@ -394,13 +253,13 @@ void IKBoneSegment3D::_process_children(Vector<BoneId> &r_children, Ref<IKBone3D
 	}
 }
 
-Ref<IKBoneSegment3D> IKBoneSegment3D::_create_child_segment(String &p_child_name, Vector<Ref<IKEffectorTemplate3D>> &p_pins, BoneId p_root_bone, BoneId p_tip_bone, ManyBoneIK3D *p_many_bone_ik, Ref<IKBoneSegment3D> &p_parent) {
-	return Ref<IKBoneSegment3D>(memnew(IKBoneSegment3D(skeleton, p_child_name, p_pins, p_many_bone_ik, p_parent, p_root_bone, p_tip_bone)));
+Ref<IKBoneSegment3D> IKBoneSegment3D::_create_child_segment(String &p_child_name, Vector<Ref<IKEffectorTemplate3D>> &p_pins, BoneId p_root_bone, BoneId p_tip_bone, Ref<IKBoneSegment3D> &p_parent) {
+	return Ref<IKBoneSegment3D>(memnew(IKBoneSegment3D(skeleton, p_child_name, p_pins, p_parent, p_root_bone, p_tip_bone)));
 }
 
-Ref<IKBone3D> IKBoneSegment3D::_create_next_bone(BoneId p_bone_id, Ref<IKBone3D> p_current_tip, Vector<Ref<IKEffectorTemplate3D>> &p_pins, ManyBoneIK3D *p_many_bone_ik) {
+Ref<IKBone3D> IKBoneSegment3D::_create_next_bone(BoneId p_bone_id, Ref<IKBone3D> p_current_tip, Vector<Ref<IKEffectorTemplate3D>> &p_pins) {
 	String bone_name = skeleton->get_bone_name(p_bone_id);
-	Ref<IKBone3D> next_bone = Ref<IKBone3D>(memnew(IKBone3D(bone_name, skeleton, p_current_tip, p_pins, p_many_bone_ik->get_default_damp(), p_many_bone_ik)));
+	Ref<IKBone3D> next_bone = Ref<IKBone3D>(memnew(IKBone3D(bone_name, skeleton, p_current_tip, p_pins, skeleton->default_damp)));
 	root_segment->bone_map[p_bone_id] = next_bone;
 
 	return next_bone;
@@ -424,4 +283,5 @@ void IKBoneSegment3D::_finalize_segment(Ref<IKBone3D> p_current_tip) {
 	set_name(ik_bone_name);
 	bones.clear();
 	create_bone_list(bones, false);
+	skeleton = nullptr;
 }
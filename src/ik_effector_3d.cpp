@@ -44,6 +44,7 @@
 void IKEffector3D::set_target_node(Skeleton3D *p_skeleton, const NodePath &p_target_node_path) {
 	ERR_FAIL_NULL(p_skeleton);
 	target_node_path = p_target_node_path;
+	invalidate_target_node_cache();
 }
 
 NodePath IKEffector3D::get_target_node() const {
@@ -74,78 +75,39 @@ Vector3 IKEffector3D::get_direction_priorities() const {
 	return direction_priorities;
 }
 
-void IKEffector3D::update_target_global_transform(Skeleton3D *p_skeleton, ManyBoneIK3D *p_many_bone_ik) {
-	ERR_FAIL_NULL(p_skeleton);
-	ERR_FAIL_COND(for_bone.is_null());
-	Node3D *current_target_node = cast_to<Node3D>(p_many_bone_ik->get_node_or_null(target_node_path));
-	if (current_target_node && current_target_node->is_visible_in_tree()) {
-		target_relative_to_skeleton_origin = p_skeleton->get_global_transform().affine_inverse() * current_target_node->get_global_transform();
+void IKEffector3D::invalidate_target_node_cache() {
+	Node *target_node = Object::cast_to<Node>(ObjectDB::get_instance(target_node_cache));
+	Callable on_tree_exiting = callable_mp(this, &IKEffector3D::invalidate_target_node_cache);
+	if (target_node && target_node->is_connected(SNAME("tree_exiting"), on_tree_exiting)) {
+		target_node->disconnect(SNAME("tree_exiting"), on_tree_exiting);
 	}
+	target_node_cache = ObjectID();
 }
 
-Transform3D IKEffector3D::get_target_global_transform() const {
-	return target_relative_to_skeleton_origin;
-}
-
-int32_t IKEffector3D::update_effector_target_headings(PackedVector3Array *p_headings, int32_t p_index, Ref<IKBone3D> p_for_bone, const Vector<double> *p_weights) const {
-	ERR_FAIL_COND_V(p_index == -1, -1);
-	ERR_FAIL_NULL_V(p_headings, -1);
-	ERR_FAIL_COND_V(p_for_bone.is_null(), -1);
-	ERR_FAIL_NULL_V(p_weights, -1);
-
-	int32_t index = p_index;
-	Vector3 bone_origin_relative_to_skeleton_origin = for_bone->get_bone_direction_global_pose().origin;
-	p_headings->write[index] = target_relative_to_skeleton_origin.origin - bone_origin_relative_to_skeleton_origin;
-	index++;
-	Vector3 priority = get_direction_priorities();
-	for (int axis = Vector3::AXIS_X; axis <= Vector3::AXIS_Z; ++axis) {
-		if (priority[axis] > 0.0) {
-			real_t w = p_weights->get(index);
-			Vector3 column = target_relative_to_skeleton_origin.basis.get_column(axis);
-
-			p_headings->write[index] = (column + target_relative_to_skeleton_origin.origin) - bone_origin_relative_to_skeleton_origin;
-			p_headings->write[index] *= Vector3(w, w, w);
-			index++;
-			p_headings->write[index] = (target_relative_to_skeleton_origin.origin - column) - bone_origin_relative_to_skeleton_origin;
-			p_headings->write[index] *= Vector3(w, w, w);
-			index++;
-		}
+Node3D *IKEffector3D::_get_target_node(ManyBoneIK3D *p_many_bone_ik) {
+	Node3D *target_node = Object::cast_to<Node3D>(ObjectDB::get_instance(target_node_cache));
+	if (target_node) {
+		return target_node;
 	}
-
-	return index;
+	// An unresolved path is looked up again on every read, so a target added to the tree later is picked up.
+	target_node = cast_to<Node3D>(p_many_bone_ik->get_node_or_null(target_node_path));
+	if (target_node) {
+		target_node_cache = target_node->get_instance_id();
+		target_node->connect(SNAME("tree_exiting"), callable_mp(this, &IKEffector3D::invalidate_target_node_cache));
+	}
+	return target_node;
 }
 
-int32_t IKEffector3D::update_effector_tip_headings(PackedVector3Array *p_headings, int32_t p_index, Ref<IKBone3D> p_for_bone) const {
-	ERR_FAIL_COND_V(p_index == -1, -1);
-	ERR_FAIL_NULL_V(p_headings, -1);
-	ERR_FAIL_COND_V(p_for_bone.is_null(), -1);
-
-	Transform3D tip_xform_relative_to_skeleton_origin = for_bone->get_bone_direction_global_pose();
-	Basis tip_basis = tip_xform_relative_to_skeleton_origin.basis;
-	Vector3 bone_origin_relative_to_skeleton_origin = p_for_bone->get_bone_direction_global_pose().origin;
-
-	int32_t index = p_index;
-	p_headings->write[index] = tip_xform_relative_to_skeleton_origin.origin - bone_origin_relative_to_skeleton_origin;
-	index++;
-	double distance = target_relative_to_skeleton_origin.origin.distance_to(bone_origin_relative_to_skeleton_origin);
-	double scale_by = MIN(distance, 1.0f);
-	const Vector3 priority = get_direction_priorities();
-
-	for (int axis = Vector3::AXIS_X; axis <= Vector3::AXIS_Z; ++axis) {
-		if (priority[axis] > 0.0) {
-			Vector3 column = tip_basis.get_column(axis) * priority[axis];
-
-			p_headings->write[index] = (column + tip_xform_relative_to_skeleton_origin.origin) - bone_origin_relative_to_skeleton_origin;
-			p_headings->write[index] *= scale_by;
-			index++;
-
-			p_headings->write[index] = (tip_xform_relative_to_skeleton_origin.origin - column) - bone_origin_relative_to_skeleton_origin;
-			p_headings->write[index] *= scale_by;
-			index++;
-		}
+void IKEffector3D::update_target_global_transform(const Transform3D &p_skeleton_global_inverse, ManyBoneIK3D *p_many_bone_ik) {
+	ERR_FAIL_NULL(p_many_bone_ik);
+	Node3D *current_target_node = _get_target_node(p_many_bone_ik);
+	if (current_target_node && current_target_node->is_visible_in_tree()) {
+		target_relative_to_skeleton_origin = p_skeleton_global_inverse * current_target_node->get_global_transform();
 	}
+}
 
-	return index;
+Transform3D IKEffector3D::get_target_global_transform() const {
+	return target_relative_to_skeleton_origin;
 }
 
 void IKEffector3D::_bind_methods() {
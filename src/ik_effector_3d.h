@@ -39,6 +39,7 @@
 
 class ManyBoneIK3D;
 class IKBone3D;
+class Node3D;
 
 class IKEffector3D : public Resource {
 	GDCLASS(IKEffector3D, Resource);
@@ -48,8 +49,8 @@ class IKEffector3D : public Resource {
 	Ref<IKBone3D> for_bone;
 	bool use_target_node_rotation = true;
 	NodePath target_node_path;
+	// Resolved lazily from target_node_path and kept until that node leaves the tree.
 	ObjectID target_node_cache;
-	Node *target_node_reference = nullptr;
 	bool target_static = false;
 	Transform3D target_transform;
 
@@ -58,13 +59,12 @@ class IKEffector3D : public Resource {
 	// See IKEffectorTemplate to change the defaults.
 	real_t weight = 0.0;
 	real_t motion_propagation_factor = 0.0;
-	PackedVector3Array target_headings;
-	PackedVector3Array tip_headings;
 	Vector<real_t> heading_weights;
 	Vector3 direction_priorities;
 
 protected:
 	static void _bind_methods();
+	Node3D *_get_target_node(ManyBoneIK3D *p_many_bone_ik);
 
 public:
 	IKEffector3D() = default;
@@ -72,7 +72,8 @@ public:
 	real_t get_weight() const;
 	void set_direction_priorities(Vector3 p_direction_priorities);
 	Vector3 get_direction_priorities() const;
-	void update_target_global_transform(Skeleton3D *p_skeleton, ManyBoneIK3D *p_modification = nullptr);
+	void update_target_global_transform(const Transform3D &p_skeleton_global_inverse, ManyBoneIK3D *p_modification);
+	void invalidate_target_node_cache();
 	const float MAX_KUSUDAMA_OPEN_CONES = 30;
 	float get_motion_propagation_factor() const;
 	void set_motion_propagation_factor(float p_motion_propagation_factor);
@@ -83,7 +84,5 @@ public:
 	bool get_target_node_rotation() const;
 	Ref<IKBone3D> get_ik_bone_3d() const;
 	bool is_following_translation_only() const;
-	int32_t update_effector_target_headings(PackedVector3Array *p_headings, int32_t p_index, Ref<IKBone3D> p_for_bone, const Vector<double> *p_weights) const;
-	int32_t update_effector_tip_headings(PackedVector3Array *p_headings, int32_t p_index, Ref<IKBone3D> p_for_bone) const;
 	IKEffector3D(const Ref<IKBone3D> &p_current_bone);
 };
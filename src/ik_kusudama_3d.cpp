@@ -103,6 +103,41 @@ void IKKusudama3D::update_tangent_radii() {
 		Ref<IKLimitCone3D> cone = open_cones[i];
 		cone->update_tangent_handles(next);
 	}
+	bake_open_cones();
+}
+
+void IKKusudama3D::bake_open_cones() {
+	baked_cones.resize(open_cones.size());
+	for (int32_t cone_i = 0; cone_i < open_cones.size(); cone_i++) {
+		BakedCone &baked = baked_cones[cone_i];
+		baked = BakedCone();
+		const Ref<IKLimitCone3D> &cone = open_cones[cone_i];
+		if (cone.is_null()) {
+			continue;
+		}
+		baked.control_point = cone->get_control_point().normalized();
+		baked.radius_cosine = cone->get_radius_cosine();
+		baked.radius_half_sin = Math::sin(cone->get_radius() * 0.5);
+		baked.radius_half_cos = Math::cos(cone->get_radius() * 0.5);
+		baked.tangent_circle_center_next_1 = cone->get_tangent_circle_center_next_1();
+		baked.tangent_circle_center_next_2 = cone->get_tangent_circle_center_next_2();
+		const double tangent_radius = cone->get_tangent_circle_radius_next();
+		baked.tangent_circle_radius_next_cos = cone->get_tangent_circle_radius_next_cos();
+		baked.tangent_circle_radius_next_half_sin = Math::sin(tangent_radius * 0.5);
+		baked.tangent_circle_radius_next_half_cos = Math::cos(tangent_radius * 0.5);
+		if (cone_i + 1 >= open_cones.size() || open_cones[cone_i + 1].is_null()) {
+			continue;
+		}
+		const Vector3 &c1 = cone->get_control_point();
+		const Vector3 &c2 = open_cones[cone_i + 1]->get_control_point();
+		const Vector3 &t1 = baked.tangent_circle_center_next_1;
+		const Vector3 &t2 = baked.tangent_circle_center_next_2;
+		baked.c1xc2 = c1.cross(c2);
+		baked.c1xt1 = c1.cross(t1).normalized();
+		baked.t1xc2 = t1.cross(c2).normalized();
+		baked.t2xc1 = t2.cross(c1).normalized();
+		baked.c2xt2 = c2.cross(t2).normalized();
+	}
 }
 
 void IKKusudama3D::set_axial_limits(real_t min_angle, real_t in_range) {
@@ -123,17 +158,18 @@ void IKKusudama3D::set_snap_to_twist_limit(Ref<IKNode3D> p_bone_direction, Ref<I
 	if (!is_axially_constrained()) {
 		return;
 	}
-	Transform3D global_transform_constraint = p_constraint_axes->get_global_transform();
-	Transform3D global_transform_to_set = p_to_set->get_global_transform();
-	Basis parent_global_inverse = p_to_set->get_parent()->get_global_transform().basis.inverse();
-	Basis global_twist_center = global_transform_constraint.basis * twist_center_rot;
-	Basis align_rot = (global_twist_center.inverse() * global_transform_to_set.basis).orthonormalized();
-	Quaternion twist_rotation, swing_rotation; // Hold the ik transform's decomposed swing and twist away from global_twist_centers's global basis.
-	get_swing_twist(align_rot.get_rotation_quaternion(), Vector3(0, 1, 0), swing_rotation, twist_rotation);
+	Quaternion rotation = get_twist_limit_rotation(p_to_set->get_global_transform().basis.get_rotation_quaternion(), p_to_set->get_parent()->get_global_transform().basis.get_rotation_quaternion(), p_constraint_axes->get_global_transform().basis.get_rotation_quaternion());
+	p_to_set->set_transform(Transform3D(Basis(rotation), p_to_set->get_transform().origin));
+}
+
+Quaternion IKKusudama3D::get_twist_limit_rotation(const Quaternion &p_to_set_global, const Quaternion &p_parent_global, const Quaternion &p_constraint_axes_global) const {
+	Quaternion global_twist_center = p_constraint_axes_global * twist_center_rot;
+	Quaternion align_rot = (global_twist_center.inverse() * p_to_set_global).normalized();
+	Quaternion twist_rotation, swing_rotation; // Hold the ik transform's decomposed swing and twist away from global_twist_centers's global rotation.
+	get_swing_twist(align_rot, Vector3(0, 1, 0), swing_rotation, twist_rotation);
 	twist_rotation = IKBoneSegment3D::clamp_to_cos_half_angle(twist_rotation, twist_half_range_half_cos);
-	Basis recomposition = (global_twist_center * (swing_rotation * twist_rotation)).orthonormalized();
-	Basis rotation = parent_global_inverse * recomposition;
-	p_to_set->set_transform(Transform3D(rotation, p_to_set->get_transform().origin));
+	Quaternion recomposition = global_twist_center * (swing_rotation * twist_rotation);
+	return (p_parent_global.inverse() * recomposition).normalized();
 }
 
 void IKKusudama3D::get_swing_twist(
@@ -174,6 +210,7 @@ void IKKusudama3D::add_open_cone(
 void IKKusudama3D::remove_open_cone(Ref<IKLimitCone3D> limitCone) {
 	ERR_FAIL_COND(limitCone.is_null());
 	open_cones.erase(limitCone);
+	bake_open_cones();
 }
 
 real_t IKKusudama3D::get_min_axial_angle() {
@@ -230,6 +267,23 @@ void IKKusudama3D::enable() {
 	orientationally_constrained = true;
 }
 
+void IKKusudama3D::resize_open_cones(int32_t p_count) {
+	ERR_FAIL_COND(p_count < 0);
+	int32_t old_count = open_cones.size();
+	open_cones.resize(p_count);
+	for (int32_t cone_i = old_count; cone_i < p_count; cone_i++) {
+		Ref<IKLimitCone3D> cone;
+		cone.instantiate();
+		cone->set_attached_to(this);
+		open_cones.write[cone_i] = cone;
+	}
+}
+
+Ref<IKLimitCone3D> IKKusudama3D::get_open_cone(int32_t p_index) const {
+	ERR_FAIL_INDEX_V(p_index, open_cones.size(), Ref<IKLimitCone3D>());
+	return open_cones[p_index];
+}
+
 TypedArray<IKLimitCone3D> IKKusudama3D::get_open_cones() const {
 	TypedArray<IKLimitCone3D> cones;
 	for (Ref<IKLimitCone3D> cone : open_cones) {
@@ -276,24 +330,34 @@ Vector3 IKKusudama3D::local_point_on_path_sequence(Vector3 p_in_point, Ref<IKNod
  * the point is outside of the boundary, but does not signify anything about how far from the boundary the point is.
  * @return the original point, if it's in limits, or the closest point which is in limits.
  */
-Vector3 IKKusudama3D::get_local_point_in_limits(Vector3 in_point, Vector<double> *in_bounds) {
-	// Normalize the input point
-	Vector3 point = in_point.normalized();
+Vector3 IKKusudama3D::get_local_point_in_limits(const Vector3 &p_in_point, double &r_in_bounds) const {
+	// Runs once per constrained bone per iteration, so it only reads the baked cones.
+	Vector3 point = p_in_point.normalized();
 	real_t closest_cos = -2.0;
-	in_bounds->write[0] = -1;
+	r_in_bounds = -1;
 
-	Vector3 closest_collision_point = in_point;
+	Vector3 closest_collision_point = p_in_point;
+	const uint32_t cone_count = baked_cones.size();
 
 	// Loop through each limit cone
-	for (int i = 0; i < open_cones.size(); i++) {
-		Ref<IKLimitCone3D> cone = open_cones[i];
-		Vector3 collision_point = cone->closest_to_cone(point, in_bounds);
-
-		// If the collision point is NaN, return the original point
-		if (Math::is_nan(collision_point.x) || Math::is_nan(collision_point.y) || Math::is_nan(collision_point.z)) {
-			in_bounds->write[0] = 1;
+	for (uint32_t i = 0; i < cone_count; i++) {
+		const BakedCone &cone = baked_cones[i];
+		// Inside any cone means inside the limits.
+		if (point.dot(cone.control_point) > cone.radius_cosine) {
+			r_in_bounds = 1;
 			return point;
 		}
+		Vector3 axis = cone.control_point.cross(point).normalized();
+		if (Math::is_zero_approx(axis.length_squared()) || !axis.is_finite()) {
+			axis = Vector3(0, 1, 0);
+		}
+		Vector3 control_point = cone.control_point;
+		if (Math::is_zero_approx(control_point.length_squared())) {
+			control_point = Vector3(0, 1, 0);
+		}
+		// The cone's boundary point closest to the input, rotated from the control point by the radius.
+		const Quaternion rot_to = Quaternion(axis.x * cone.radius_half_sin, axis.y * cone.radius_half_sin, axis.z * cone.radius_half_sin, cone.radius_half_cos);
+		Vector3 collision_point = rot_to.xform(control_point);
 
 		// Calculate the cosine of the angle between the collision point and the original point
 		real_t this_cos = collision_point.dot(point);
@@ -305,31 +369,41 @@ Vector3 IKKusudama3D::get_local_point_in_limits(Vector3 in_point, Vector<double>
 		}
 	}
 
-	// If we're out of bounds of all cones, check if we're in the paths between the cones
-	if ((*in_bounds)[0] == -1) {
-		for (int i = 0; i < open_cones.size() - 1; i++) {
-			Ref<IKLimitCone3D> currCone = open_cones[i];
-			Ref<IKLimitCone3D> nextCone = open_cones[i + 1];
-			Vector3 collision_point = currCone->get_on_great_tangent_triangle(nextCone, point);
-
-			// If the collision point is NaN, skip to the next iteration
-			if (Math::is_nan(collision_point.x)) {
+	// We're out of bounds of all cones, so check if we're in the paths between the cones
+	for (uint32_t i = 0; i + 1 < cone_count; i++) {
+		const BakedCone &cone = baked_cones[i];
+		Vector3 tangent_center;
+		if (point.dot(cone.c1xc2) < 0.0) {
+			if (point.dot(cone.c1xt1) <= 0 || point.dot(cone.t1xc2) <= 0) {
 				continue;
 			}
+			tangent_center = cone.tangent_circle_center_next_1;
+		} else {
+			if (point.dot(cone.t2xc1) <= 0 || point.dot(cone.c2xt2) <= 0) {
+				continue;
+			}
+			tangent_center = cone.tangent_circle_center_next_2;
+		}
+		Vector3 collision_point = point;
+		if (point.dot(tangent_center) > cone.tangent_circle_radius_next_cos) {
+			// Inside the tangent circle, so the closest point in limits is on its boundary.
+			Vector3 plane_normal = tangent_center.cross(point).normalized();
+			const Quaternion rotate_about_by = Quaternion(plane_normal.x * cone.tangent_circle_radius_next_half_sin, plane_normal.y * cone.tangent_circle_radius_next_half_sin, plane_normal.z * cone.tangent_circle_radius_next_half_sin, cone.tangent_circle_radius_next_half_cos);
+			collision_point = rotate_about_by.xform(tangent_center);
+		}
 
-			real_t this_cos = collision_point.dot(point);
+		real_t this_cos = collision_point.dot(point);
 
-			// If the cosine is approximately 1, return the original point
-			if (Math::is_equal_approx(this_cos, real_t(1.0))) {
-				in_bounds->write[0] = 1;
-				return point;
-			}
+		// If the cosine is approximately 1, return the original point
+		if (Math::is_equal_approx(this_cos, real_t(1.0))) {
+			r_in_bounds = 1;
+			return point;
+		}
 
-			// If the cosine is greater than the current closest cosine, update the closest collision point and cosine
-			if (this_cos > closest_cos) {
-				closest_collision_point = collision_point;
-				closest_cos = this_cos;
-			}
+		// If the cosine is greater than the current closest cosine, update the closest collision point and cosine
+		if (this_cos > closest_cos) {
+			closest_collision_point = collision_point;
+			closest_cos = this_cos;
 		}
 	}
 
@@ -348,6 +422,7 @@ void IKKusudama3D::set_open_cones(TypedArray<IKLimitCone3D> p_cones) {
 	for (int32_t i = 0; i < p_cones.size(); i++) {
 		open_cones.write[i] = p_cones[i];
 	}
+	bake_open_cones();
 }
 
 void IKKusudama3D::snap_to_orientation_limit(Ref<IKNode3D> bone_direction, Ref<IKNode3D> to_set, Ref<IKNode3D> limiting_axes, real_t p_dampening, real_t p_cos_half_angle_dampen) {
@@ -360,25 +435,25 @@ void IKKusudama3D::snap_to_orientation_limit(Ref<IKNode3D> bone_direction, Ref<I
 	if (limiting_axes.is_null()) {
 		return;
 	}
-	Vector<double> in_bounds;
-	in_bounds.resize(1);
-	in_bounds.write[0] = 1.0;
-	Vector3 limiting_origin = limiting_axes->get_global_transform().origin;
-	Vector3 bone_dir_xform = bone_direction->get_global_transform().xform(Vector3(0.0, 1.0, 0.0));
-
-	bone_ray->set_point_1(limiting_origin);
-	bone_ray->set_point_2(bone_dir_xform);
+	Quaternion rectified_rot;
+	if (get_orientation_limit_rotation(IKRigidTransform3D(bone_direction->get_global_transform()), IKRigidTransform3D(limiting_axes->get_global_transform()), rectified_rot)) {
+		to_set->rotate_local_with_global(rectified_rot);
+	}
+}
 
-	Vector3 bone_tip = limiting_axes->to_local(bone_ray->get_point_2());
-	Vector3 in_limits = get_local_point_in_limits(bone_tip, &in_bounds);
+bool IKKusudama3D::get_orientation_limit_rotation(const IKRigidTransform3D &p_bone_direction_global, const IKRigidTransform3D &p_limiting_axes_global, Quaternion &r_rotation) const {
+	double in_bounds = 1.0;
+	const Vector3 limiting_origin = p_limiting_axes_global.origin;
+	const Vector3 bone_dir_xform = p_bone_direction_global.xform(Vector3(0.0, 1.0, 0.0));
 
-	if (in_bounds[0] < 0) {
-		constrained_ray->set_point_1(bone_ray->get_point_1());
-		constrained_ray->set_point_2(limiting_axes->to_global(in_limits));
+	Vector3 bone_tip = p_limiting_axes_global.xform_inv(bone_dir_xform);
+	Vector3 in_limits = get_local_point_in_limits(bone_tip, in_bounds);
 
-		Quaternion rectified_rot = Quaternion(bone_ray->get_heading(), constrained_ray->get_heading());
-		to_set->rotate_local_with_global(rectified_rot);
+	if (in_bounds >= 0) {
+		return false;
 	}
+	r_rotation = Quaternion(bone_dir_xform - limiting_origin, p_limiting_axes_global.xform(in_limits) - limiting_origin);
+	return true;
 }
 
 bool IKKusudama3D::is_nan_vector(const Vector3 &vec) {
@@ -418,6 +493,7 @@ Quaternion IKKusudama3D::clamp_to_quadrance_angle(Quaternion p_rotation, double
 
 void IKKusudama3D::clear_open_cones() {
 	open_cones.clear();
+	baked_cones.clear();
 }
 
 Quaternion IKKusudama3D::get_quaternion_axis_angle(const Vector3 &p_axis, real_t p_angle) {
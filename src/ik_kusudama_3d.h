@@ -35,10 +35,12 @@
 #include "ik_open_cone_3d.h"
 #include "ik_ray_3d.h"
 #include "math/ik_node_3d.h"
+#include "math/ik_rigid_transform_3d.h"
 
 #include "core/io/resource.h"
 #include "core/math/quaternion.h"
 #include "core/object/ref_counted.h"
+#include "core/templates/local_vector.h"
 #include "core/variant/typed_array.h"
 #include "scene/3d/node_3d.h"
 
@@ -54,6 +56,29 @@ class IKKusudama3D : public Resource {
 	 */
 	Vector<Ref<IKLimitCone3D>> open_cones;
 
+	/**
+	 * The open cones flattened for get_local_point_in_limits, which reads these instead of the
+	 * IKLimitCone3D resources. Rebaked by update_tangent_radii. The planes bound the great tangent
+	 * triangles to the next cone and are zero on the last cone.
+	 */
+	struct BakedCone {
+		Vector3 control_point;
+		real_t radius_cosine = 0;
+		real_t radius_half_sin = 0;
+		real_t radius_half_cos = 1;
+		Vector3 tangent_circle_center_next_1;
+		Vector3 tangent_circle_center_next_2;
+		real_t tangent_circle_radius_next_cos = 0;
+		real_t tangent_circle_radius_next_half_sin = 0;
+		real_t tangent_circle_radius_next_half_cos = 1;
+		Vector3 c1xc2;
+		Vector3 c1xt1;
+		Vector3 t1xc2;
+		Vector3 t2xc1;
+		Vector3 c2xt2;
+	};
+	LocalVector<BakedCone> baked_cones;
+
 	Quaternion twist_min_rot;
 	Vector3 twist_min_vec;
 	Vector3 twist_max_vec;
@@ -90,9 +115,7 @@ public:
 	void _update_constraint(Ref<IKNode3D> p_limiting_axes);
 
 	void update_tangent_radii();
-
-	Ref<IKRay3D> bone_ray = Ref<IKRay3D>(memnew(IKRay3D()));
-	Ref<IKRay3D> constrained_ray = Ref<IKRay3D>(memnew(IKRay3D()));
+	void bake_open_cones();
 	double unit_hyper_area = 2 * Math::pow(Math::PI, 2);
 	double unit_area = 4 * Math::PI;
 
@@ -123,6 +146,16 @@ public:
 	 */
 	void snap_to_orientation_limit(Ref<IKNode3D> p_bone_direction, Ref<IKNode3D> p_to_set, Ref<IKNode3D> p_limiting_axes, real_t p_dampening, real_t p_cos_half_angle_dampen);
 
+	/**
+	 * Same as snap_to_orientation_limit, but works on plain global rigid transforms.
+	 *
+	 * @param p_bone_direction_global the global transform of the bone direction.
+	 * @param p_limiting_axes_global the global transform of the constraint orientation.
+	 * @param r_rotation set to the global rotation that brings the bone back within the limits.
+	 * @return true if the bone was out of bounds and r_rotation should be applied.
+	 */
+	bool get_orientation_limit_rotation(const IKRigidTransform3D &p_bone_direction_global, const IKRigidTransform3D &p_limiting_axes_global, Quaternion &r_rotation) const;
+
 	bool is_nan_vector(const Vector3 &vec);
 
 	/**
@@ -146,6 +179,13 @@ public:
 	 */
 	void set_snap_to_twist_limit(Ref<IKNode3D> p_bone_direction, Ref<IKNode3D> p_to_set, Ref<IKNode3D> p_limiting_axes, real_t p_dampening, real_t p_cos_half_dampen);
 
+	/**
+	 * Same as set_snap_to_twist_limit, but works on plain global rotations.
+	 *
+	 * @return the local rotation of the bone with its twist clamped to the axial limits.
+	 */
+	Quaternion get_twist_limit_rotation(const Quaternion &p_to_set_global, const Quaternion &p_parent_global, const Quaternion &p_constraint_axes_global) const;
+
 	/**
 	 * Given a point (in local coordinates), checks to see if a ray can be extended from the Kusudama's
 	 * origin to that point, such that the ray in the Kusudama's reference frame is within the range_angle allowed by the Kusudama's
@@ -154,14 +194,12 @@ public:
 	 * If it cannot exist, the tip of the ray within the kusudama's limits that would require the least rotation
 	 * to arrive at the input point is returned.
 	 * @param in_point the point to test.
-	 * @param in_bounds should be an array with at least 2 elements. The first element will be set to  a number from -1 to 1 representing the point's distance from the boundary, 0 means the point is right on
+	 * @param r_in_bounds will be set to a number from -1 to 1 representing the point's distance from the boundary, 0 means the point is right on
 	 * the boundary, 1 means the point is within the boundary and on the path furthest from the boundary. any negative number means
 	 * the point is outside of the boundary, but does not signify anything about how far from the boundary the point is.
-	 * The second element will be given a value corresponding to the limit cone whose bounds were exceeded. If the bounds were exceeded on a segment between two limit cones,
-	 * this value will be set to a non-integer value between the two indices of the limitcone comprising the segment whose bounds were exceeded.
 	 * @return the original point, if it's in limits, or the closest point which is in limits.
 	 */
-	Vector3 get_local_point_in_limits(Vector3 in_point, Vector<double> *in_bounds);
+	Vector3 get_local_point_in_limits(const Vector3 &p_in_point, double &r_in_bounds) const;
 
 	Vector3 local_point_on_path_sequence(Vector3 in_point, Ref<IKNode3D> limiting_axes);
 
@@ -192,6 +230,10 @@ public:
 	void disable();
 	void enable();
 	void clear_open_cones();
+	// Keeps the first p_count cones and instantiates the missing ones, so that a kusudama can be
+	// reconfigured without reallocating its cones. Call update_tangent_radii once the cones are set.
+	void resize_open_cones(int32_t p_count);
+	Ref<IKLimitCone3D> get_open_cone(int32_t p_index) const;
 	TypedArray<IKLimitCone3D> get_open_cones() const;
 	void set_open_cones(TypedArray<IKLimitCone3D> p_cones);
 	float get_resistance();
@@ -132,7 +132,7 @@ double IKLimitCone3D::get_tangent_circle_radius_next() {
 	return tangent_circle_radius_next;
 }
 
-double IKLimitCone3D::_get_tangent_circle_radius_next_cos() {
+double IKLimitCone3D::get_tangent_circle_radius_next_cos() const {
 	return tangent_circle_radius_next_cos;
 }
 
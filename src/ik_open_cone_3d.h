@@ -93,8 +93,6 @@ class IKLimitCone3D : public Resource {
 	 */
 	Vector3 _closest_point_on_closest_cone(Ref<IKLimitCone3D> next, Vector3 input, Vector<double> *in_bounds) const;
 
-	double _get_tangent_circle_radius_next_cos();
-
 public:
 	IKLimitCone3D() {}
 	virtual ~IKLimitCone3D() {}
@@ -112,6 +110,7 @@ public:
 	 */
 	Vector3 get_on_great_tangent_triangle(Ref<IKLimitCone3D> next, Vector3 input) const;
 	double get_tangent_circle_radius_next();
+	double get_tangent_circle_radius_next_cos() const;
 	Vector3 get_tangent_circle_center_next_1();
 	Vector3 get_tangent_circle_center_next_2();
 
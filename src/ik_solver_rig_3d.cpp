@@ -0,0 +1,1154 @@
+/**************************************************************************/
+/*  ik_solver_rig_3d.cpp                                                  */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#include "ik_solver_rig_3d.h"
+
+#include "ik_bone_3d.h"
+#include "ik_bone_segment_3d.h"
+#include "ik_effector_3d.h"
+#include "ik_kusudama_3d.h"
+#include "many_bone_ik_3d.h"
+#include "many_bone_ik_3d_state.h"
+
+#include "core/object/worker_thread_pool.h"
+
+IKSolverRig3D::~IKSolverRig3D() {
+	clear();
+}
+
+void IKSolverRig3D::clear() {
+	bone_ids.clear();
+	parents.clear();
+	subtree_ends.clear();
+	local_poses.clear();
+	global_poses.clear();
+	bone_directions.clear();
+	constraint_orientations.clear();
+	constraint_twists.clear();
+	constraint_ids.clear();
+	constraints.clear();
+	cos_half_damps.clear();
+	ik_bones.clear();
+	bone_indices.clear();
+	effector_indices.clear();
+	effectors.clear();
+	effector_targets.clear();
+	ik_effectors.clear();
+	owned_effectors.clear();
+	owned_constraints.clear();
+	segments.clear();
+	schedule.clear();
+	level_segments.clear();
+	level_offsets.clear();
+	root_segments.clear();
+	segment_children.clear();
+	segment_effectors.clear();
+	heading_weights.clear();
+	segment_effector_falloffs.clear();
+	target_headings.clear();
+	heading_origins.clear();
+	previous_deviations.clear();
+	input_poses.clear();
+	input_scales.clear();
+	input_targets.clear();
+	has_inputs = false;
+}
+
+void IKSolverRig3D::build(const Vector<Ref<IKBoneSegment3D>> &p_segmented_skeletons, const Vector<float> &p_damp, float p_default_damp) {
+	clear();
+	for (const Ref<IKBoneSegment3D> &segmented_skeleton : p_segmented_skeletons) {
+		if (segmented_skeleton.is_null()) {
+			continue;
+		}
+		root_segments.push_back(_add_segment(segmented_skeleton, -1, p_damp, p_default_damp));
+	}
+	effector_indices.clear();
+
+	// Effector bones can only be resolved once every bone has an index.
+	for (uint32_t effector_i = 0; effector_i < effectors.size(); effector_i++) {
+		Ref<IKBone3D> effector_bone = ik_effectors[effector_i]->get_ik_bone_3d();
+		ERR_FAIL_COND(effector_bone.is_null());
+		effectors[effector_i].bone = find_bone(effector_bone->get_bone_id());
+		if (effectors[effector_i].bone == -1) {
+			clear();
+			ERR_FAIL_MSG("Pinned bone is not part of the solver rig.");
+		}
+	}
+
+	if (!_has_consistent_headings()) {
+		clear();
+		ERR_FAIL_MSG("Segment heading weights do not match its effectors.");
+	}
+	if (!_update_effector_falloffs()) {
+		clear();
+		ERR_FAIL_MSG("Segment effectors do not match the motion propagation of their pins.");
+	}
+	_finish_build();
+}
+
+void IKSolverRig3D::_finish_build() {
+	heading_origins.resize(segment_effectors.size());
+	target_headings.resize(heading_weights.size());
+	_update_target_headings();
+	_build_levels();
+
+	input_poses.resize(bone_ids.size());
+	input_scales.resize(bone_ids.size());
+	input_targets.resize(effectors.size());
+
+	previous_deviations.resize(segments.size());
+	for (double &deviation : previous_deviations) {
+		deviation = INFINITY;
+	}
+	for (uint32_t bone_i = 0; bone_i < bone_ids.size(); bone_i++) {
+		int32_t parent = parents[bone_i];
+		global_poses[bone_i] = parent == -1 ? local_poses[bone_i] : global_poses[parent] * local_poses[bone_i];
+	}
+	memory_high_water_mark = MAX(memory_high_water_mark, get_memory_usage());
+}
+
+static bool _is_index_range_valid(int32_t p_begin, int32_t p_end, int32_t p_size) {
+	return p_begin >= 0 && p_begin <= p_end && p_end <= p_size;
+}
+
+static bool _is_state_valid(const ManyBoneIK3DState *p_state, int32_t p_skeleton_bone_count) {
+	const PackedInt32Array bones = p_state->get_bones();
+	const PackedInt32Array segments = p_state->get_segments();
+	const PackedInt32Array steps = p_state->get_steps();
+	const int32_t bone_count = bones.size() / ManyBoneIK3DState::BONE_STRIDE;
+	const int32_t segment_count = segments.size() / ManyBoneIK3DState::SEGMENT_STRIDE;
+	const int32_t step_count = steps.size() / ManyBoneIK3DState::STEP_STRIDE;
+	const int32_t effector_count = p_state->get_effector_bones().size();
+	const int32_t constraint_count = p_state->get_constraint_flags().size();
+	if (bone_count == 0 || bones.size() != bone_count * ManyBoneIK3DState::BONE_STRIDE || segments.size() != segment_count * ManyBoneIK3DState::SEGMENT_STRIDE || steps.size() != step_count * ManyBoneIK3DState::STEP_STRIDE) {
+		return false;
+	}
+	if (p_state->get_bone_transforms().size() != bone_count * ManyBoneIK3DState::BONE_TRANSFORM_STRIDE || p_state->get_step_damps().size() != step_count) {
+		return false;
+	}
+	if (p_state->get_effector_direction_priorities().size() != effector_count || p_state->get_effector_target_nodes().size() != effector_count) {
+		return false;
+	}
+	if (p_state->get_constraint_axial_limits().size() != constraint_count || p_state->get_constraint_cone_offsets().size() != constraint_count + 1) {
+		return false;
+	}
+	const Array bone_transforms = p_state->get_bone_transforms();
+	for (int32_t transform_i = 0; transform_i < bone_transforms.size(); transform_i++) {
+		if (bone_transforms[transform_i].get_type() != Variant::TRANSFORM3D) {
+			return false;
+		}
+	}
+	for (int32_t bone_i = 0; bone_i < bone_count; bone_i++) {
+		const int32_t *bone = bones.ptr() + bone_i * ManyBoneIK3DState::BONE_STRIDE;
+		if (bone[0] < -1 || bone[0] >= p_skeleton_bone_count || bone[1] < -1 || bone[1] >= bone_i || bone[2] <= bone_i || bone[2] > bone_count || bone[3] < -1 || bone[3] >= constraint_count) {
+			return false;
+		}
+	}
+	const int32_t heading_count = p_state->get_heading_weights().size();
+	const PackedInt32Array segment_children = p_state->get_segment_children();
+	const int32_t child_count = segment_children.size();
+	const int32_t segment_effector_count = p_state->get_segment_effectors().size();
+	for (int32_t segment_i = 0; segment_i < segment_count; segment_i++) {
+		const int32_t *segment = segments.ptr() + segment_i * ManyBoneIK3DState::SEGMENT_STRIDE;
+		if (segment[0] < -1 || segment[0] >= segment_count) {
+			return false;
+		}
+		if (!_is_index_range_valid(segment[1], segment[2], bone_count) || !_is_index_range_valid(segment[3], segment[4], segment_effector_count) || !_is_index_range_valid(segment[5], segment[6], heading_count) || !_is_index_range_valid(segment[7], segment[8], child_count) || !_is_index_range_valid(segment[9], segment[10], step_count)) {
+			return false;
+		}
+		// Children always follow their parent, which is what the level build relies on.
+		for (int32_t child_i = segment[7]; child_i < segment[8]; child_i++) {
+			if (segment_children[child_i] <= segment_i || segment_children[child_i] >= segment_count) {
+				return false;
+			}
+		}
+	}
+	for (int32_t step_i = 0; step_i < step_count; step_i++) {
+		const int32_t *step = steps.ptr() + step_i * ManyBoneIK3DState::STEP_STRIDE;
+		if (step[0] < 0 || step[0] >= bone_count || step[1] < 0 || step[1] >= segment_count) {
+			return false;
+		}
+	}
+	for (int32_t segment_index : p_state->get_root_segments()) {
+		if (segment_index < 0 || segment_index >= segment_count) {
+			return false;
+		}
+	}
+	for (int32_t segment_index : segment_children) {
+		if (segment_index < 0 || segment_index >= segment_count) {
+			return false;
+		}
+	}
+	for (int32_t effector_index : p_state->get_segment_effectors()) {
+		if (effector_index < 0 || effector_index >= effector_count) {
+			return false;
+		}
+	}
+	for (int32_t effector_bone : p_state->get_effector_bones()) {
+		if (effector_bone < 0 || effector_bone >= bone_count) {
+			return false;
+		}
+	}
+	const PackedInt32Array cone_offsets = p_state->get_constraint_cone_offsets();
+	for (int32_t constraint_i = 0; constraint_i < constraint_count; constraint_i++) {
+		if (cone_offsets[constraint_i] < 0 || cone_offsets[constraint_i] > cone_offsets[constraint_i + 1]) {
+			return false;
+		}
+	}
+	return cone_offsets[constraint_count] * ManyBoneIK3DState::CONE_STRIDE == p_state->get_constraint_cones().size();
+}
+
+bool IKSolverRig3D::build_from_state(const ManyBoneIK3DState *p_state, Skeleton3D *p_skeleton) {
+	clear();
+	ERR_FAIL_NULL_V(p_state, false);
+	ERR_FAIL_NULL_V(p_skeleton, false);
+	ERR_FAIL_COND_V_MSG(!_is_state_valid(p_state, p_skeleton->get_bone_count()), false, "ManyBoneIK3DState is malformed or was baked for another skeleton.");
+
+	const PackedFloat64Array &cones = p_state->constraint_cones;
+	for (int32_t constraint_i = 0; constraint_i < p_state->constraint_flags.size(); constraint_i++) {
+		Ref<IKKusudama3D> constraint;
+		constraint.instantiate();
+		for (int32_t cone_i = p_state->constraint_cone_offsets[constraint_i]; cone_i < p_state->constraint_cone_offsets[constraint_i + 1]; cone_i++) {
+			const double *cone_data = cones.ptr() + cone_i * ManyBoneIK3DState::CONE_STRIDE;
+			Ref<IKLimitCone3D> cone;
+			cone.instantiate();
+			cone->set_attached_to(constraint);
+			cone->set_radius(cone_data[3]);
+			cone->set_control_point(Vector3(cone_data[0], cone_data[1], cone_data[2]));
+			constraint->add_open_cone(cone);
+		}
+		const Vector2 &axial_limit = p_state->constraint_axial_limits[constraint_i];
+		constraint->set_axial_limits(axial_limit.x, axial_limit.y);
+		if (p_state->constraint_flags[constraint_i] & ManyBoneIK3DState::CONSTRAINT_FLAG_ORIENTATIONAL) {
+			constraint->enable_orientational_limits();
+		}
+		if (p_state->constraint_flags[constraint_i] & ManyBoneIK3DState::CONSTRAINT_FLAG_AXIAL) {
+			constraint->enable_axial_limits();
+		}
+		owned_constraints.push_back(constraint);
+		constraints.push_back(constraint.ptr());
+	}
+
+	const int32_t bone_count = p_state->get_bone_count();
+	bone_ids.resize(bone_count);
+	parents.resize(bone_count);
+	subtree_ends.resize(bone_count);
+	constraint_ids.resize(bone_count);
+	local_poses.resize(bone_count);
+	global_poses.resize(bone_count);
+	bone_directions.resize(bone_count);
+	constraint_orientations.resize(bone_count);
+	constraint_twists.resize(bone_count);
+	for (int32_t bone_i = 0; bone_i < bone_count; bone_i++) {
+		const int32_t *bone = p_state->bones.ptr() + bone_i * ManyBoneIK3DState::BONE_STRIDE;
+		bone_ids[bone_i] = bone[0];
+		parents[bone_i] = bone[1];
+		subtree_ends[bone_i] = bone[2];
+		constraint_ids[bone_i] = bone[3];
+		int32_t transform_i = bone_i * ManyBoneIK3DState::BONE_TRANSFORM_STRIDE;
+		local_poses[bone_i] = IKRigidTransform3D(Transform3D(p_state->bone_transforms[transform_i]));
+		bone_directions[bone_i] = IKRigidTransform3D(Transform3D(p_state->bone_transforms[transform_i + 1]));
+		constraint_orientations[bone_i] = IKRigidTransform3D(Transform3D(p_state->bone_transforms[transform_i + 2]));
+		constraint_twists[bone_i] = IKRigidTransform3D(Transform3D(p_state->bone_transforms[transform_i + 3]));
+		bone_indices.insert(bone[0], bone_i);
+	}
+
+	for (int32_t effector_i = 0; effector_i < p_state->effector_bones.size(); effector_i++) {
+		Ref<IKEffector3D> ik_effector;
+		ik_effector.instantiate();
+		ik_effector->set_direction_priorities(p_state->effector_direction_priorities[effector_i]);
+		ik_effector->set_target_node(p_skeleton, p_state->effector_target_nodes[effector_i]);
+		Effector effector;
+		effector.bone = p_state->effector_bones[effector_i];
+		effector.direction_priorities = ik_effector->get_direction_priorities();
+		effectors.push_back(effector);
+		effector_targets.push_back(ik_effector->get_target_global_transform());
+		ik_effectors.push_back(ik_effector.ptr());
+		owned_effectors.push_back(ik_effector);
+	}
+
+	const int32_t segment_count = p_state->segments.size() / ManyBoneIK3DState::SEGMENT_STRIDE;
+	segments.resize(segment_count);
+	for (int32_t segment_i = 0; segment_i < segment_count; segment_i++) {
+		const int32_t *data = p_state->segments.ptr() + segment_i * ManyBoneIK3DState::SEGMENT_STRIDE;
+		Segment &segment = segments[segment_i];
+		segment.parent = data[0];
+		segment.bone_begin = data[1];
+		segment.bone_end = data[2];
+		segment.effector_begin = data[3];
+		segment.effector_end = data[4];
+		segment.heading_begin = data[5];
+		segment.heading_end = data[6];
+		segment.child_begin = data[7];
+		segment.child_end = data[8];
+		segment.step_begin = data[9];
+		segment.step_end = data[10];
+		segment.stabilization_passes = data[11];
+		segment.translate = data[12] != 0;
+	}
+	const int32_t step_count = p_state->step_damps.size();
+	schedule.resize(step_count);
+	for (int32_t step_i = 0; step_i < step_count; step_i++) {
+		schedule[step_i].bone = p_state->steps[step_i * ManyBoneIK3DState::STEP_STRIDE];
+		schedule[step_i].segment = p_state->steps[step_i * ManyBoneIK3DState::STEP_STRIDE + 1];
+		schedule[step_i].cos_half_damp = p_state->step_damps[step_i];
+	}
+	for (int32_t segment_index : p_state->root_segments) {
+		root_segments.push_back(segment_index);
+	}
+	for (int32_t segment_index : p_state->segment_children) {
+		segment_children.push_back(segment_index);
+	}
+	for (int32_t effector_index : p_state->segment_effectors) {
+		segment_effectors.push_back(effector_index);
+	}
+	for (double weight : p_state->heading_weights) {
+		heading_weights.push_back(weight);
+	}
+
+	if (!_has_consistent_headings()) {
+		clear();
+		ERR_FAIL_V_MSG(false, "ManyBoneIK3DState heading weights do not match its effectors.");
+	}
+	_finish_build();
+	return true;
+}
+
+void IKSolverRig3D::bake_state(ManyBoneIK3DState *r_state) const {
+	ERR_FAIL_NULL(r_state);
+	// Arrays are shared by reference, so fresh ones are filled rather than resizing those of the state.
+	Array bone_transforms;
+	bone_transforms.resize(bone_ids.size() * ManyBoneIK3DState::BONE_TRANSFORM_STRIDE);
+	r_state->bones.resize(bone_ids.size() * ManyBoneIK3DState::BONE_STRIDE);
+	int32_t *bones = r_state->bones.ptrw();
+	for (uint32_t bone_i = 0; bone_i < bone_ids.size(); bone_i++) {
+		int32_t *bone = bones + bone_i * ManyBoneIK3DState::BONE_STRIDE;
+		bone[0] = bone_ids[bone_i];
+		bone[1] = parents[bone_i];
+		bone[2] = subtree_ends[bone_i];
+		bone[3] = constraint_ids[bone_i];
+		int32_t transform_i = bone_i * ManyBoneIK3DState::BONE_TRANSFORM_STRIDE;
+		bone_transforms[transform_i] = local_poses[bone_i].to_transform();
+		bone_transforms[transform_i + 1] = bone_directions[bone_i].to_transform();
+		bone_transforms[transform_i + 2] = constraint_orientations[bone_i].to_transform();
+		bone_transforms[transform_i + 3] = constraint_twists[bone_i].to_transform();
+	}
+	r_state->bone_transforms = bone_transforms;
+
+	r_state->segments.resize(segments.size() * ManyBoneIK3DState::SEGMENT_STRIDE);
+	int32_t *segment_data = r_state->segments.ptrw();
+	for (const Segment &segment : segments) {
+		segment_data[0] = segment.parent;
+		segment_data[1] = segment.bone_begin;
+		segment_data[2] = segment.bone_end;
+		segment_data[3] = segment.effector_begin;
+		segment_data[4] = segment.effector_end;
+		segment_data[5] = segment.heading_begin;
+		segment_data[6] = segment.heading_end;
+		segment_data[7] = segment.child_begin;
+		segment_data[8] = segment.child_end;
+		segment_data[9] = segment.step_begin;
+		segment_data[10] = segment.step_end;
+		segment_data[11] = segment.stabilization_passes;
+		segment_data[12] = segment.translate ? 1 : 0;
+		segment_data += ManyBoneIK3DState::SEGMENT_STRIDE;
+	}
+	r_state->steps.resize(schedule.size() * ManyBoneIK3DState::STEP_STRIDE);
+	r_state->step_damps.resize(schedule.size());
+	for (uint32_t step_i = 0; step_i < schedule.size(); step_i++) {
+		r_state->steps.set(step_i * ManyBoneIK3DState::STEP_STRIDE, schedule[step_i].bone);
+		r_state->steps.set(step_i * ManyBoneIK3DState::STEP_STRIDE + 1, schedule[step_i].segment);
+		r_state->step_damps.set(step_i, schedule[step_i].cos_half_damp);
+	}
+	r_state->root_segments.clear();
+	for (int32_t segment_index : root_segments) {
+		r_state->root_segments.push_back(segment_index);
+	}
+	r_state->segment_children.clear();
+	for (int32_t segment_index : segment_children) {
+		r_state->segment_children.push_back(segment_index);
+	}
+	r_state->segment_effectors.clear();
+	for (int32_t effector_index : segment_effectors) {
+		r_state->segment_effectors.push_back(effector_index);
+	}
+	r_state->heading_weights.clear();
+	for (double weight : heading_weights) {
+		r_state->heading_weights.push_back(weight);
+	}
+
+	r_state->effector_bones.clear();
+	r_state->effector_direction_priorities.clear();
+	Array effector_target_nodes;
+	for (uint32_t effector_i = 0; effector_i < effectors.size(); effector_i++) {
+		r_state->effector_bones.push_back(effectors[effector_i].bone);
+		r_state->effector_direction_priorities.push_back(effectors[effector_i].direction_priorities);
+		effector_target_nodes.push_back(ik_effectors[effector_i]->get_target_node());
+	}
+	r_state->effector_target_nodes = effector_target_nodes;
+
+	// Cones are stored as the solver uses them, already normalized and after the tangent update of the constraint.
+	r_state->constraint_flags.clear();
+	r_state->constraint_axial_limits.clear();
+	r_state->constraint_cone_offsets.clear();
+	r_state->constraint_cones.clear();
+	r_state->constraint_cone_offsets.push_back(0);
+	for (IKKusudama3D *constraint : constraints) {
+		int32_t flags = 0;
+		if (constraint->is_orientationally_constrained()) {
+			flags |= ManyBoneIK3DState::CONSTRAINT_FLAG_ORIENTATIONAL;
+		}
+		if (constraint->is_axially_constrained()) {
+			flags |= ManyBoneIK3DState::CONSTRAINT_FLAG_AXIAL;
+		}
+		r_state->constraint_flags.push_back(flags);
+		r_state->constraint_axial_limits.push_back(Vector2(constraint->get_min_axial_angle(), constraint->get_range_angle()));
+		TypedArray<IKLimitCone3D> open_cones = constraint->get_open_cones();
+		int32_t cone_count = 0;
+		for (int32_t cone_i = 0; cone_i < open_cones.size(); cone_i++) {
+			Ref<IKLimitCone3D> cone = open_cones[cone_i];
+			if (cone.is_null()) {
+				continue;
+			}
+			Vector3 control_point = cone->get_control_point();
+			r_state->constraint_cones.push_back(control_point.x);
+			r_state->constraint_cones.push_back(control_point.y);
+			r_state->constraint_cones.push_back(control_point.z);
+			r_state->constraint_cones.push_back(cone->get_radius());
+			cone_count++;
+		}
+		r_state->constraint_cone_offsets.push_back(r_state->constraint_cone_offsets[r_state->constraint_cone_offsets.size() - 1] + cone_count);
+	}
+}
+
+int32_t IKSolverRig3D::_add_segment(const Ref<IKBoneSegment3D> &p_segment, int32_t p_parent, const Vector<float> &p_damp, float p_default_damp) {
+	int32_t segment_index = segments.size();
+	segments.push_back(Segment());
+
+	Segment segment;
+	segment.parent = p_parent;
+	segment.translate = p_parent == -1;
+	segment.stabilization_passes = p_segment->default_stabilizing_pass_count;
+
+	segment.bone_begin = bone_ids.size();
+	const Vector<Ref<IKBone3D>> &segment_bones = p_segment->bones;
+	for (int32_t bone_i = segment_bones.size(); bone_i-- > 0;) {
+		const Ref<IKBone3D> &bone = segment_bones[bone_i];
+		ERR_CONTINUE(bone.is_null());
+		int32_t index = bone_ids.size();
+		int32_t parent = -1;
+		if (bone->get_parent().is_valid()) {
+			parent = find_bone(bone->get_parent()->get_bone_id());
+		}
+		bone_ids.push_back(bone->get_bone_id());
+		parents.push_back(parent);
+		subtree_ends.push_back(index + 1);
+		local_poses.push_back(IKRigidTransform3D(bone->get_pose()));
+		global_poses.push_back(IKRigidTransform3D());
+		bone_directions.push_back(IKRigidTransform3D(bone->get_bone_direction_transform()->get_transform()));
+		constraint_orientations.push_back(IKRigidTransform3D(bone->get_constraint_orientation_transform()->get_transform()));
+		constraint_twists.push_back(IKRigidTransform3D(bone->get_constraint_twist_transform()->get_transform()));
+
+		float damp = Math::PI;
+		if (!segment.translate) {
+			damp = p_default_damp;
+			if (bone->get_bone_id() >= 0 && bone->get_bone_id() < p_damp.size()) {
+				damp = p_damp[bone->get_bone_id()];
+			}
+			if (p_default_damp < damp) {
+				damp = p_default_damp;
+			}
+		}
+		cos_half_damps.push_back(Math::cos(damp / 2.0));
+
+		int32_t constraint_id = -1;
+		Ref<IKKusudama3D> constraint = bone->get_constraint();
+		if (constraint.is_valid() && constraint->is_enabled()) {
+			constraint_id = constraints.size();
+			constraints.push_back(constraint.ptr());
+		}
+		constraint_ids.push_back(constraint_id);
+		ik_bones.push_back(bone.ptr());
+		bone_indices.insert(bone->get_bone_id(), index);
+	}
+	segment.bone_end = bone_ids.size();
+
+	if (p_segment->is_pinned()) {
+		// The tip's own pin heads the effector list, so adding it first keeps the effector order.
+		segment.pin_effector = _add_effector(p_segment->get_tip()->get_pin().ptr());
+	}
+	segment.effector_begin = segment_effectors.size();
+	for (const Ref<IKEffector3D> &effector : p_segment->effector_list) {
+		if (effector.is_null()) {
+			continue;
+		}
+		segment_effectors.push_back(_add_effector(effector.ptr()));
+	}
+	segment.effector_end = segment_effectors.size();
+
+	segment.heading_begin = heading_weights.size();
+	for (double weight : p_segment->heading_weights) {
+		heading_weights.push_back(weight);
+	}
+	segment.heading_end = heading_weights.size();
+
+	// Reserve the child range first so that it stays contiguous while the children append their own.
+	segment.child_begin = segment_children.size();
+	for (const Ref<IKBoneSegment3D> &child : p_segment->child_segments) {
+		if (child.is_valid()) {
+			segment_children.push_back(-1);
+		}
+	}
+	segment.child_end = segment_children.size();
+	int32_t child_i = segment.child_begin;
+	for (const Ref<IKBoneSegment3D> &child : p_segment->child_segments) {
+		if (child.is_valid()) {
+			int32_t child_index = _add_segment(child, segment_index, p_damp, p_default_damp);
+			segment_children[child_i++] = child_index;
+		}
+	}
+
+	for (int32_t bone_i = segment.bone_begin; bone_i < segment.bone_end; bone_i++) {
+		subtree_ends[bone_i] = bone_ids.size();
+	}
+	// The children have appended their steps by now, so this segment's bones follow them tip first.
+	segment.step_begin = schedule.size();
+	for (int32_t bone_i = segment.bone_end; bone_i-- > segment.bone_begin;) {
+		Step step;
+		step.bone = bone_i;
+		step.segment = segment_index;
+		step.cos_half_damp = cos_half_damps[bone_i];
+		schedule.push_back(step);
+	}
+	segment.step_end = schedule.size();
+	segments[segment_index] = segment;
+	return segment_index;
+}
+
+bool IKSolverRig3D::_has_consistent_headings() const {
+	for (const Segment &segment : segments) {
+		int32_t heading_count = 0;
+		for (int32_t effector_i = segment.effector_begin; effector_i < segment.effector_end; effector_i++) {
+			const Vector3 &priority = effectors[segment_effectors[effector_i]].direction_priorities;
+			heading_count++;
+			for (int axis = Vector3::AXIS_X; axis <= Vector3::AXIS_Z; ++axis) {
+				if (priority[axis] > 0.0) {
+					heading_count += 2;
+				}
+			}
+		}
+		if (heading_count != segment.heading_end - segment.heading_begin) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static int32_t _get_heading_count(const Vector3 &p_direction_priorities) {
+	int32_t heading_count = 1;
+	for (int axis = Vector3::AXIS_X; axis <= Vector3::AXIS_Z; ++axis) {
+		if (p_direction_priorities[axis] > 0.0) {
+			heading_count += 2;
+		}
+	}
+	return heading_count;
+}
+
+bool IKSolverRig3D::_update_effector_falloffs() {
+	segment_effector_falloffs.resize(segment_effectors.size());
+	for (uint32_t segment_i = 0; segment_i < segments.size(); segment_i++) {
+		const Segment &segment = segments[segment_i];
+		int32_t segment_effector_i = segment.effector_begin;
+		if (!_collect_effector_falloffs(segment_i, 1.0, segment_effector_i, segment.effector_end) || segment_effector_i != segment.effector_end) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool IKSolverRig3D::_collect_effector_falloffs(int32_t p_segment, double p_falloff, int32_t &r_segment_effector, int32_t p_segment_effector_end) {
+	// Mirrors IKBoneSegment3D::recursive_create_penalty_array, which laid out the segment's effectors in the same preorder.
+	if (p_falloff <= 0.0) {
+		return true;
+	}
+	const Segment &segment = segments[p_segment];
+	double current_falloff = 1.0;
+	if (segment.pin_effector != -1) {
+		if (r_segment_effector >= p_segment_effector_end || segment_effectors[r_segment_effector] != segment.pin_effector) {
+			return false;
+		}
+		segment_effector_falloffs[r_segment_effector++] = p_falloff;
+		current_falloff = effectors[segment.pin_effector].motion_propagation_factor;
+	}
+	for (int32_t child_i = segment.child_begin; child_i < segment.child_end; child_i++) {
+		if (!_collect_effector_falloffs(segment_children[child_i], p_falloff * current_falloff, r_segment_effector, p_segment_effector_end)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void IKSolverRig3D::_update_effector_heading_weights(int32_t p_effector) {
+	for (const Segment &segment : segments) {
+		int32_t heading_i = segment.heading_begin;
+		for (int32_t effector_i = segment.effector_begin; effector_i < segment.effector_end; effector_i++) {
+			int32_t effector_index = segment_effectors[effector_i];
+			const Vector3 &priorities = effectors[effector_index].direction_priorities;
+			if (p_effector != -1 && effector_index != p_effector) {
+				heading_i += _get_heading_count(priorities);
+				continue;
+			}
+			const double weight = ik_effectors[effector_index]->get_weight() * segment_effector_falloffs[effector_i];
+			double max_priority = MAX(MAX(priorities.x, priorities.y), priorities.z);
+			max_priority = max_priority == 0.0 ? 1.0 : max_priority;
+			heading_weights[heading_i++] = weight;
+			for (int axis = Vector3::AXIS_X; axis <= Vector3::AXIS_Z; ++axis) {
+				if (priorities[axis] > 0.0) {
+					double sub_target_weight = weight * (priorities[axis] / max_priority);
+					heading_weights[heading_i++] = sub_target_weight;
+					heading_weights[heading_i++] = sub_target_weight;
+				}
+			}
+		}
+	}
+}
+
+bool IKSolverRig3D::set_effector_weights(int32_t p_effector, real_t p_weight, const Vector3 &p_direction_priorities, real_t p_motion_propagation_factor) {
+	ERR_FAIL_INDEX_V(p_effector, int32_t(effectors.size()), false);
+	if (segment_effector_falloffs.size() != segment_effectors.size()) {
+		// A rig built from a state does not know the motion propagation of its pins.
+		return false;
+	}
+	Effector &effector = effectors[p_effector];
+	if (_get_heading_count(p_direction_priorities) != _get_heading_count(effector.direction_priorities)) {
+		return false;
+	}
+	IKEffector3D *ik_effector = ik_effectors[p_effector];
+	ik_effector->set_weight(p_weight);
+	ik_effector->set_direction_priorities(p_direction_priorities);
+	ik_effector->set_motion_propagation_factor(p_motion_propagation_factor);
+	effector.direction_priorities = p_direction_priorities;
+	int32_t updated_effector = p_effector;
+	if (effector.motion_propagation_factor != p_motion_propagation_factor) {
+		// The propagation scales every pin below this one, and reaching zero drops them from the segments above it.
+		effector.motion_propagation_factor = p_motion_propagation_factor;
+		if (!_update_effector_falloffs()) {
+			return false;
+		}
+		updated_effector = -1;
+	}
+	_update_effector_heading_weights(updated_effector);
+	_update_target_headings();
+	has_inputs = false;
+	return true;
+}
+
+void IKSolverRig3D::_build_levels() {
+	// Children are always added after their parent, so a reverse walk sees every child first.
+	LocalVector<int32_t> heights;
+	heights.resize(segments.size());
+	int32_t level_count = 0;
+	for (uint32_t segment_i = segments.size(); segment_i-- > 0;) {
+		const Segment &segment = segments[segment_i];
+		int32_t height = 0;
+		for (int32_t child_i = segment.child_begin; child_i < segment.child_end; child_i++) {
+			height = MAX(height, heights[segment_children[child_i]] + 1);
+		}
+		heights[segment_i] = height;
+		level_count = MAX(level_count, height + 1);
+	}
+	level_offsets.resize(level_count + 1);
+	for (int32_t &offset : level_offsets) {
+		offset = 0;
+	}
+	for (int32_t height : heights) {
+		level_offsets[height + 1]++;
+	}
+	for (int32_t level_i = 0; level_i < level_count; level_i++) {
+		level_offsets[level_i + 1] += level_offsets[level_i];
+	}
+	level_segments.resize(segments.size());
+	LocalVector<int32_t> cursors;
+	cursors.resize(level_count);
+	for (int32_t level_i = 0; level_i < level_count; level_i++) {
+		cursors[level_i] = level_offsets[level_i];
+	}
+	for (uint32_t segment_i = 0; segment_i < segments.size(); segment_i++) {
+		level_segments[cursors[heights[segment_i]]++] = segment_i;
+	}
+}
+
+int32_t IKSolverRig3D::_add_effector(IKEffector3D *p_effector) {
+	HashMap<IKEffector3D *, int32_t>::Iterator E = effector_indices.find(p_effector);
+	if (E) {
+		return E->value;
+	}
+	int32_t index = effectors.size();
+	Effector effector;
+	effector.direction_priorities = p_effector->get_direction_priorities();
+	effector.motion_propagation_factor = p_effector->get_motion_propagation_factor();
+	effectors.push_back(effector);
+	effector_targets.push_back(p_effector->get_target_global_transform());
+	ik_effectors.push_back(p_effector);
+	effector_indices.insert(p_effector, index);
+	return index;
+}
+
+bool IKSolverRig3D::is_empty() const {
+	return bone_ids.is_empty();
+}
+
+int32_t IKSolverRig3D::get_bone_count() const {
+	return bone_ids.size();
+}
+
+template <typename T>
+static uint64_t _get_storage_size(const LocalVector<T> &p_vector) {
+	return uint64_t(p_vector.size()) * sizeof(T);
+}
+
+uint64_t IKSolverRig3D::get_memory_usage() const {
+	uint64_t usage = _get_storage_size(bone_ids) + _get_storage_size(parents) + _get_storage_size(subtree_ends);
+	usage += _get_storage_size(local_poses) + _get_storage_size(global_poses) + _get_storage_size(bone_directions);
+	usage += _get_storage_size(constraint_orientations) + _get_storage_size(constraint_twists) + _get_storage_size(constraint_ids);
+	usage += _get_storage_size(constraints) + _get_storage_size(cos_half_damps) + _get_storage_size(ik_bones);
+	usage += uint64_t(bone_indices.size()) * (sizeof(BoneId) + sizeof(int32_t));
+	usage += _get_storage_size(effectors) + _get_storage_size(effector_targets) + _get_storage_size(ik_effectors);
+	usage += _get_storage_size(segments) + _get_storage_size(schedule) + _get_storage_size(level_segments) + _get_storage_size(level_offsets);
+	usage += _get_storage_size(root_segments) + _get_storage_size(segment_children) + _get_storage_size(segment_effectors);
+	usage += _get_storage_size(heading_weights) + _get_storage_size(segment_effector_falloffs) + _get_storage_size(previous_deviations) + _get_storage_size(target_headings) + _get_storage_size(heading_origins);
+	usage += _get_storage_size(input_poses) + _get_storage_size(input_scales) + _get_storage_size(input_targets);
+	return usage;
+}
+
+uint64_t IKSolverRig3D::get_memory_high_water_mark() const {
+	return memory_high_water_mark;
+}
+
+int32_t IKSolverRig3D::find_bone(BoneId p_bone) const {
+	HashMap<BoneId, int32_t>::ConstIterator E = bone_indices.find(p_bone);
+	if (!E) {
+		return -1;
+	}
+	return E->value;
+}
+
+int32_t IKSolverRig3D::find_effector(BoneId p_bone) const {
+	int32_t bone_i = find_bone(p_bone);
+	if (bone_i == -1) {
+		return -1;
+	}
+	for (uint32_t effector_i = 0; effector_i < effectors.size(); effector_i++) {
+		if (effectors[effector_i].bone == bone_i) {
+			return effector_i;
+		}
+	}
+	return -1;
+}
+
+void IKSolverRig3D::read_skeleton_poses(Skeleton3D *p_skeleton, real_t p_warm_start) {
+	ERR_FAIL_NULL(p_skeleton);
+	for (uint32_t bone_i = 0; bone_i < bone_ids.size(); bone_i++) {
+		BoneId bone_id = bone_ids[bone_i];
+		if (bone_id == -1) {
+			continue;
+		}
+		const Vector3 bone_scale = p_skeleton->get_bone_pose_scale(bone_id);
+		input_scales[bone_i] = bone_scale;
+		input_poses[bone_i] = IKRigidTransform3D(p_skeleton->get_bone_pose_rotation(bone_id), p_skeleton->get_bone_pose_position(bone_id), (bone_scale.x + bone_scale.y + bone_scale.z) / 3.0);
+		if (p_warm_start <= 0.0) {
+			local_poses[bone_i] = input_poses[bone_i];
+		} else if (p_warm_start < 1.0) {
+			local_poses[bone_i] = input_poses[bone_i].interpolate_with(local_poses[bone_i], p_warm_start);
+		}
+		int32_t parent = parents[bone_i];
+		global_poses[bone_i] = parent == -1 ? local_poses[bone_i] : global_poses[parent] * local_poses[bone_i];
+	}
+	for (uint32_t effector_i = 0; effector_i < effectors.size(); effector_i++) {
+		input_targets[effector_i] = effector_targets[effector_i];
+	}
+	has_inputs = true;
+}
+
+static bool _is_vector_within(const Vector3 &p_a, const Vector3 &p_b, real_t p_epsilon) {
+	Vector3 difference = (p_a - p_b).abs();
+	return difference.x <= p_epsilon && difference.y <= p_epsilon && difference.z <= p_epsilon;
+}
+
+static bool _is_transform_within(const Transform3D &p_a, const Transform3D &p_b, real_t p_epsilon) {
+	for (int axis = Vector3::AXIS_X; axis <= Vector3::AXIS_Z; ++axis) {
+		if (!_is_vector_within(p_a.basis.rows[axis], p_b.basis.rows[axis], p_epsilon)) {
+			return false;
+		}
+	}
+	return _is_vector_within(p_a.origin, p_b.origin, p_epsilon);
+}
+
+bool IKSolverRig3D::is_input_unchanged(const Skeleton3D *p_skeleton, real_t p_epsilon) const {
+	ERR_FAIL_NULL_V(p_skeleton, false);
+	if (!has_inputs) {
+		return false;
+	}
+	// Targets first: they are already in the rig, while every bone pose has to be fetched from the skeleton.
+	for (uint32_t effector_i = 0; effector_i < effectors.size(); effector_i++) {
+		if (!_is_transform_within(effector_targets[effector_i], input_targets[effector_i], p_epsilon)) {
+			return false;
+		}
+	}
+	for (uint32_t bone_i = 0; bone_i < bone_ids.size(); bone_i++) {
+		BoneId bone_id = bone_ids[bone_i];
+		if (bone_id == -1) {
+			continue;
+		}
+		const IKRigidTransform3D &input_pose = input_poses[bone_i];
+		const Quaternion rotation = p_skeleton->get_bone_pose_rotation(bone_id);
+		if (!_is_vector_within(p_skeleton->get_bone_pose_position(bone_id), input_pose.origin, p_epsilon) || !_is_vector_within(p_skeleton->get_bone_pose_scale(bone_id), input_scales[bone_i], p_epsilon)) {
+			return false;
+		}
+		if (Math::abs(rotation.x - input_pose.rotation.x) > p_epsilon || Math::abs(rotation.y - input_pose.rotation.y) > p_epsilon || Math::abs(rotation.z - input_pose.rotation.z) > p_epsilon || Math::abs(rotation.w - input_pose.rotation.w) > p_epsilon) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void IKSolverRig3D::read_effector_targets(const Transform3D &p_skeleton_global_inverse, ManyBoneIK3D *p_many_bone_ik) {
+	for (uint32_t effector_i = 0; effector_i < effectors.size(); effector_i++) {
+		IKEffector3D *effector = ik_effectors[effector_i];
+		effector->update_target_global_transform(p_skeleton_global_inverse, p_many_bone_ik);
+		effector_targets[effector_i] = effector->get_target_global_transform();
+	}
+	_update_target_headings();
+}
+
+void IKSolverRig3D::invalidate_effector_target_nodes() {
+	for (IKEffector3D *effector : ik_effectors) {
+		effector->invalidate_target_node_cache();
+	}
+}
+
+void IKSolverRig3D::set_effector_target_node(int32_t p_effector, Skeleton3D *p_skeleton, const NodePath &p_target_node) {
+	ERR_FAIL_INDEX(p_effector, int32_t(effectors.size()));
+	ik_effectors[p_effector]->set_target_node(p_skeleton, p_target_node);
+	has_inputs = false;
+}
+
+void IKSolverRig3D::_update_target_headings() {
+	for (const Segment &segment : segments) {
+		int32_t heading_i = segment.heading_begin;
+		for (int32_t effector_i = segment.effector_begin; effector_i < segment.effector_end; effector_i++) {
+			int32_t effector_index = segment_effectors[effector_i];
+			const Effector &effector = effectors[effector_index];
+			const Transform3D &target = effector_targets[effector_index];
+			target_headings[heading_i++] = target.origin;
+			for (int axis = Vector3::AXIS_X; axis <= Vector3::AXIS_Z; ++axis) {
+				if (effector.direction_priorities[axis] > 0.0) {
+					real_t w = heading_weights[heading_i];
+					Vector3 column = target.basis.get_column(axis);
+					target_headings[heading_i++] = (target.origin + column) * w;
+					target_headings[heading_i++] = (target.origin - column) * w;
+				}
+			}
+		}
+	}
+}
+
+void IKSolverRig3D::write_skeleton_poses(Skeleton3D *p_skeleton) const {
+	ERR_FAIL_NULL(p_skeleton);
+	for (uint32_t bone_i = 0; bone_i < bone_ids.size(); bone_i++) {
+		BoneId bone_id = bone_ids[bone_i];
+		if (bone_id == -1) {
+			continue;
+		}
+		// The solve only rotates and translates, so the skeleton keeps its own scale.
+		const IKRigidTransform3D &bone_to_parent = local_poses[bone_i];
+		p_skeleton->set_bone_pose_position(bone_id, bone_to_parent.origin);
+		p_skeleton->set_bone_pose_rotation(bone_id, bone_to_parent.rotation.is_finite() ? bone_to_parent.rotation : Quaternion());
+	}
+}
+
+void IKSolverRig3D::sync_ik_bones() const {
+	for (uint32_t bone_i = 0; bone_i < ik_bones.size(); bone_i++) {
+		ik_bones[bone_i]->get_constraint_orientation_transform()->set_transform(constraint_orientations[bone_i].to_transform());
+	}
+}
+
+void IKSolverRig3D::set_bone_direction(BoneId p_bone, const Transform3D &p_transform) {
+	int32_t bone_i = find_bone(p_bone);
+	if (bone_i == -1) {
+		return;
+	}
+	bone_directions[bone_i] = IKRigidTransform3D(p_transform);
+	has_inputs = false;
+}
+
+void IKSolverRig3D::set_constraint_orientation(BoneId p_bone, const Transform3D &p_transform) {
+	int32_t bone_i = find_bone(p_bone);
+	if (bone_i == -1) {
+		return;
+	}
+	constraint_orientations[bone_i] = IKRigidTransform3D(p_transform);
+	has_inputs = false;
+}
+
+void IKSolverRig3D::set_constraint(BoneId p_bone, IKKusudama3D *p_constraint) {
+	int32_t bone_i = find_bone(p_bone);
+	if (bone_i == -1) {
+		return;
+	}
+	has_inputs = false;
+	if (!p_constraint || !p_constraint->is_enabled()) {
+		constraint_ids[bone_i] = -1;
+		return;
+	}
+	if (constraint_ids[bone_i] == -1) {
+		constraint_ids[bone_i] = constraints.size();
+		constraints.push_back(p_constraint);
+		return;
+	}
+	constraints[constraint_ids[bone_i]] = p_constraint;
+}
+
+void IKSolverRig3D::set_constraint_twist(BoneId p_bone, const Transform3D &p_transform) {
+	int32_t bone_i = find_bone(p_bone);
+	if (bone_i == -1) {
+		return;
+	}
+	constraint_twists[bone_i] = IKRigidTransform3D(p_transform);
+	has_inputs = false;
+}
+
+void IKSolverRig3D::solve(bool p_constraint_mode, bool p_multithreaded) {
+	if (!p_multithreaded) {
+		for (const Step &step : schedule) {
+			_update_optimal_rotation(step, p_constraint_mode);
+		}
+		return;
+	}
+	// A segment only reads its own subtree and its ancestors, and only writes its own subtree.
+	// Solving level by level therefore does the same arithmetic as the serial schedule.
+	LevelSolve level;
+	level.constraint_mode = p_constraint_mode;
+	for (uint32_t level_i = 0; level_i + 1 < level_offsets.size(); level_i++) {
+		level.segments = level_segments.ptr() + level_offsets[level_i];
+		int32_t segment_count = level_offsets[level_i + 1] - level_offsets[level_i];
+		if (segment_count == 1) {
+			_solve_level_segment(0, &level);
+			continue;
+		}
+		WorkerThreadPool::GroupID group_id = WorkerThreadPool::get_singleton()->add_template_group_task(this, &IKSolverRig3D::_solve_level_segment, &level, segment_count, -1, true, SNAME("ManyBoneIK3DSolveLevel"));
+		WorkerThreadPool::get_singleton()->wait_for_group_task_completion(group_id);
+	}
+}
+
+void IKSolverRig3D::get_effector_errors(double &r_position_error, double &r_orientation_error) const {
+	r_position_error = 0.0;
+	r_orientation_error = 0.0;
+	for (uint32_t effector_i = 0; effector_i < effectors.size(); effector_i++) {
+		const Effector &effector = effectors[effector_i];
+		const Transform3D &target = effector_targets[effector_i];
+		IKRigidTransform3D tip = global_poses[effector.bone] * bone_directions[effector.bone];
+		r_position_error = MAX(r_position_error, (double)tip.origin.distance_to(target.origin));
+		for (int axis = Vector3::AXIS_X; axis <= Vector3::AXIS_Z; ++axis) {
+			if (effector.direction_priorities[axis] > 0.0) {
+				r_orientation_error = MAX(r_orientation_error, (double)tip.get_column(axis).angle_to(target.basis.get_column(axis)));
+			}
+		}
+	}
+}
+
+void IKSolverRig3D::_solve_level_segment(uint32_t p_index, const LevelSolve *p_level) {
+	const Segment &segment = segments[p_level->segments[p_index]];
+	for (int32_t step_i = segment.step_begin; step_i < segment.step_end; step_i++) {
+		_update_optimal_rotation(schedule[step_i], p_level->constraint_mode);
+	}
+}
+
+void IKSolverRig3D::_update_optimal_rotation(const Step &p_step, bool p_constraint_mode) {
+	const int32_t bone = p_step.bone;
+	const Segment &segment = segments[p_step.segment];
+	const int32_t heading_count = segment.heading_end - segment.heading_begin;
+	const double *weights = heading_weights.ptr() + segment.heading_begin;
+	_update_heading_origins(segment);
+	IKRigidTransform3D prev_transform = local_poses[bone];
+	bool got_closer = true;
+	int32_t pass_i = 0;
+	do {
+		// The stabilization check is evaluated from these moments, so only rotations about the bone are applied between here and there.
+		QCPMoments moments;
+		_aggregate_moments(segment, bone, moments);
+		const Quaternion pass_rotation = global_poses[bone].rotation;
+		if (!p_constraint_mode) {
+			QCPResult superpose_result;
+			if (heading_count <= QuaternionCharacteristicPolynomial::MAX_SMALL_COUNT) {
+				Vector3 target[QuaternionCharacteristicPolynomial::MAX_SMALL_COUNT];
+				Vector3 moved[QuaternionCharacteristicPolynomial::MAX_SMALL_COUNT];
+				_update_small_headings(segment, bone, target, moved);
+				superpose_result = QuaternionCharacteristicPolynomial::superpose_small(moved, target, weights, heading_count, segment.translate, evec_prec, eval_prec, max_eigenvalue_iterations);
+			} else {
+				superpose_result = QuaternionCharacteristicPolynomial::superpose_moments(moments, segment.translate, evec_prec, eval_prec, max_eigenvalue_iterations);
+			}
+			Quaternion rotation = superpose_result.rotation;
+			Vector3 translation = superpose_result.translation;
+			rotation = IKBoneSegment3D::clamp_to_cos_half_angle(rotation, p_step.cos_half_damp);
+			_rotate_with_global(bone, rotation);
+			if (segment.translate) {
+				int32_t parent = parents[bone];
+				local_poses[bone].origin += parent == -1 ? translation : global_poses[parent].basis_xform_inv(translation);
+				_update_global_poses(bone);
+			}
+			constraint_orientations[bone].origin = local_poses[bone].origin;
+		}
+		int32_t parent = parents[bone];
+		int32_t constraint_id = constraint_ids[bone];
+		if (parent != -1 && constraint_id != -1) {
+			IKKusudama3D *constraint = constraints[constraint_id];
+			const IKRigidTransform3D &parent_global = global_poses[parent];
+			if (constraint->is_orientationally_constrained()) {
+				Quaternion rectified_rotation;
+				if (constraint->get_orientation_limit_rotation(global_poses[bone] * bone_directions[bone], parent_global * constraint_orientations[bone], rectified_rotation)) {
+					_rotate_with_global(bone, rectified_rotation);
+				}
+			}
+			if (constraint->is_axially_constrained()) {
+				local_poses[bone].rotation = constraint->get_twist_limit_rotation(global_poses[bone].rotation, parent_global.rotation, parent_global.rotation * constraint_twists[bone].rotation);
+				_update_global_poses(bone);
+			}
+		}
+		if (segment.stabilization_passes > 0) {
+			double current_msd = 0.0;
+			if (segment.translate) {
+				// Translation changes how the directional tip headings are scaled, so gather them again.
+				_aggregate_moments(segment, bone, moments);
+				current_msd = QuaternionCharacteristicPolynomial::get_rotated_msd(moments, Basis());
+			} else {
+				current_msd = QuaternionCharacteristicPolynomial::get_rotated_msd(moments, Basis(global_poses[bone].rotation * pass_rotation.inverse()));
+			}
+			if (current_msd <= previous_deviations[p_step.segment] * 1.0001) {
+				previous_deviations[p_step.segment] = current_msd;
+				got_closer = true;
+				break;
+			} else {
+				got_closer = false;
+				local_poses[bone] = prev_transform;
+				_update_global_poses(bone);
+			}
+		}
+		pass_i++;
+	} while (pass_i < segment.stabilization_passes && !got_closer);
+
+	if (bone == segment.bone_begin) {
+		previous_deviations[p_step.segment] = INFINITY;
+	}
+}
+
+void IKSolverRig3D::_update_heading_origins(const Segment &p_segment) {
+	for (int32_t effector_i = p_segment.effector_begin; effector_i < p_segment.effector_end; effector_i++) {
+		int32_t effector_bone = effectors[segment_effectors[effector_i]].bone;
+		heading_origins[effector_i] = global_poses[effector_bone].xform(bone_directions[effector_bone].origin);
+	}
+}
+
+void IKSolverRig3D::_aggregate_moments(const Segment &p_segment, int32_t p_bone, QCPMoments &r_moments) const {
+	// Each effector adds its position heading and, per weighted axis, a pair of headings mirrored
+	// about it. Summing those in closed form makes an effector cost the same whatever its heading count,
+	// which is less work than a vectorized pass over the expanded headings, so the solver has no such pass.
+	r_moments = QCPMoments();
+	Vector3 bone_origin = global_poses[p_bone].xform(bone_directions[p_bone].origin);
+	int32_t heading_i = p_segment.heading_begin;
+	for (int32_t effector_i = p_segment.effector_begin; effector_i < p_segment.effector_end; effector_i++) {
+		int32_t effector_index = segment_effectors[effector_i];
+		const Effector &effector = effectors[effector_index];
+		const Vector3 &heading_origin = heading_origins[effector_i];
+		IKRigidTransform3D tip = global_poses[effector.bone] * bone_directions[effector.bone];
+		Vector3 tip_heading = tip.origin - bone_origin;
+		const Vector3 &target_origin = target_headings[heading_i];
+		r_moments.add(heading_weights[heading_i++], target_origin - heading_origin, tip_heading);
+		double scale_by = MIN(target_origin.distance_to(bone_origin), 1.0);
+		for (int axis = Vector3::AXIS_X; axis <= Vector3::AXIS_Z; ++axis) {
+			if (effector.direction_priorities[axis] > 0.0) {
+				real_t w = heading_weights[heading_i];
+				const Vector3 &target_plus = target_headings[heading_i];
+				const Vector3 &target_minus = target_headings[heading_i + 1];
+				Vector3 column = tip.get_column(axis) * effector.direction_priorities[axis];
+				r_moments.add_symmetric_pair(w, (target_plus + target_minus) * 0.5 - heading_origin * w, (target_plus - target_minus) * 0.5, tip_heading * scale_by, column * scale_by);
+				heading_i += 2;
+			}
+		}
+	}
+}
+
+void IKSolverRig3D::_update_small_headings(const Segment &p_segment, int32_t p_bone, Vector3 *r_target, Vector3 *r_tip) const {
+	Vector3 bone_origin = global_poses[p_bone].xform(bone_directions[p_bone].origin);
+	int32_t heading_i = p_segment.heading_begin;
+	int32_t index = 0;
+	for (int32_t effector_i = p_segment.effector_begin; effector_i < p_segment.effector_end; effector_i++) {
+		int32_t effector_index = segment_effectors[effector_i];
+		const Effector &effector = effectors[effector_index];
+		const Vector3 &heading_origin = heading_origins[effector_i];
+		IKRigidTransform3D tip = global_poses[effector.bone] * bone_directions[effector.bone];
+		Vector3 tip_heading = tip.origin - bone_origin;
+		const Vector3 &target_origin = target_headings[heading_i++];
+		r_target[index] = target_origin - heading_origin;
+		r_tip[index++] = tip_heading;
+		double scale_by = MIN(target_origin.distance_to(bone_origin), 1.0);
+		for (int axis = Vector3::AXIS_X; axis <= Vector3::AXIS_Z; ++axis) {
+			if (effector.direction_priorities[axis] > 0.0) {
+				real_t w = heading_weights[heading_i];
+				Vector3 tip_column = tip.get_column(axis) * effector.direction_priorities[axis];
+				r_target[index] = target_headings[heading_i++] - heading_origin * w;
+				r_tip[index++] = (tip_heading + tip_column) * scale_by;
+				r_target[index] = target_headings[heading_i++] - heading_origin * w;
+				r_tip[index++] = (tip_heading - tip_column) * scale_by;
+			}
+		}
+	}
+}
+
+void IKSolverRig3D::_rotate_with_global(int32_t p_bone, const Quaternion &p_rotation) {
+	int32_t parent = parents[p_bone];
+	IKRigidTransform3D &local_pose = local_poses[p_bone];
+	// Renormalizing is the only drift correction a quaternion needs.
+	if (parent == -1) {
+		local_pose.rotation = (p_rotation * local_pose.rotation).normalized();
+	} else {
+		const Quaternion &parent_rotation = global_poses[parent].rotation;
+		local_pose.rotation = (parent_rotation.inverse() * p_rotation * parent_rotation * local_pose.rotation).normalized();
+	}
+	_update_global_poses(p_bone);
+}
+
+void IKSolverRig3D::_update_global_poses(int32_t p_bone) {
+	int32_t subtree_end = subtree_ends[p_bone];
+	for (int32_t bone_i = p_bone; bone_i < subtree_end; bone_i++) {
+		int32_t parent = parents[bone_i];
+		global_poses[bone_i] = parent == -1 ? local_poses[bone_i] : global_poses[parent] * local_poses[bone_i];
+	}
+}
@@ -0,0 +1,202 @@
+/**************************************************************************/
+/*  ik_solver_rig_3d.h                                                    */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#pragma once
+
+#include "core/math/transform_3d.h"
+#include "core/templates/hash_map.h"
+#include "core/templates/local_vector.h"
+#include "math/ik_rigid_transform_3d.h"
+#include "math/qcp.h"
+#include "scene/3d/skeleton_3d.h"
+
+class IKBone3D;
+class IKBoneSegment3D;
+class IKEffector3D;
+class IKKusudama3D;
+class ManyBoneIK3D;
+class ManyBoneIK3DState;
+
+// Flat structure-of-arrays copy of the segmented IKBone3D graph. It is compiled
+// once per topology change and is the only thing touched by the per-frame solve.
+// The IKBone3D / IKNode3D graph remains the source of truth for the editor and scripting.
+class IKSolverRig3D {
+public:
+	struct Segment {
+		int32_t parent = -1;
+		// Bones are stored root first; the solver walks them from the tip back to the root.
+		int32_t bone_begin = 0;
+		int32_t bone_end = 0;
+		int32_t effector_begin = 0;
+		int32_t effector_end = 0;
+		int32_t heading_begin = 0;
+		int32_t heading_end = 0;
+		int32_t child_begin = 0;
+		int32_t child_end = 0;
+		int32_t step_begin = 0;
+		int32_t step_end = 0;
+		int32_t stabilization_passes = 0;
+		int32_t pin_effector = -1; // The effector of the pinned tip bone. Only known for a rig built from the graph.
+		bool translate = false;
+	};
+
+	// One bone update of the solve. Steps are stored in solve order: child segments before their
+	// parent and, inside a segment, the tip bone first, so a solve iteration is a single linear walk.
+	struct Step {
+		int32_t bone = -1;
+		int32_t segment = -1;
+		double cos_half_damp = 1.0;
+	};
+
+	struct Effector {
+		int32_t bone = -1;
+		Vector3 direction_priorities;
+		real_t motion_propagation_factor = 0.0;
+	};
+
+private:
+	// Per bone, in depth-first order so that parents always precede their children
+	// and every subtree is the contiguous range [i, subtree_ends[i]).
+	LocalVector<BoneId> bone_ids;
+	LocalVector<int32_t> parents;
+	LocalVector<int32_t> subtree_ends;
+	// Poses are rigid during the solve: scale is read as uniform and never written back to the skeleton.
+	LocalVector<IKRigidTransform3D> local_poses;
+	LocalVector<IKRigidTransform3D> global_poses;
+	LocalVector<IKRigidTransform3D> bone_directions; // Relative to the bone.
+	LocalVector<IKRigidTransform3D> constraint_orientations; // Relative to the parent bone.
+	LocalVector<IKRigidTransform3D> constraint_twists; // Relative to the parent bone.
+	LocalVector<int32_t> constraint_ids;
+	LocalVector<IKKusudama3D *> constraints;
+	LocalVector<double> cos_half_damps;
+	LocalVector<IKBone3D *> ik_bones;
+	HashMap<BoneId, int32_t> bone_indices;
+	HashMap<IKEffector3D *, int32_t> effector_indices; // Only used while building.
+
+	LocalVector<Effector> effectors;
+	LocalVector<Transform3D> effector_targets;
+	LocalVector<IKEffector3D *> ik_effectors;
+	// Objects recreated by build_from_state; a rig compiled from the graph references the graph's own instead.
+	LocalVector<Ref<IKEffector3D>> owned_effectors;
+	LocalVector<Ref<IKKusudama3D>> owned_constraints;
+
+	LocalVector<Segment> segments;
+	LocalVector<Step> schedule;
+	// Segments grouped by height above their deepest leaf. Segments of one level never contain
+	// one another, so each level can be solved in parallel once the levels below it are done.
+	LocalVector<int32_t> level_segments;
+	LocalVector<int32_t> level_offsets;
+	LocalVector<int32_t> root_segments;
+	LocalVector<int32_t> segment_children;
+	LocalVector<int32_t> segment_effectors;
+	LocalVector<double> heading_weights;
+	// Per segment effector, the motion propagation falloff its headings are weighted by. Only for a rig built from the graph.
+	LocalVector<double> segment_effector_falloffs;
+	LocalVector<double> previous_deviations;
+
+	// Skeleton poses and effector targets the current solution was solved from.
+	LocalVector<IKRigidTransform3D> input_poses;
+	LocalVector<Vector3> input_scales;
+	LocalVector<Transform3D> input_targets;
+	bool has_inputs = false;
+	uint64_t memory_high_water_mark = 0;
+
+	// Per heading, in skeleton space and before the origin offset: the target origin for position
+	// headings and (origin +/- column) * weight for directional ones. Refreshed with the targets once per frame.
+	LocalVector<Vector3> target_headings;
+	LocalVector<Vector3> heading_origins; // Per segment effector, the tip origin its target headings are measured from during the current bone update.
+
+	const double evec_prec = static_cast<double>(1E-6);
+	const double eval_prec = QuaternionCharacteristicPolynomial::DEFAULT_EIGENVALUE_PRECISION;
+	const int32_t max_eigenvalue_iterations = QuaternionCharacteristicPolynomial::DEFAULT_MAX_ITERATIONS;
+
+	int32_t _add_segment(const Ref<IKBoneSegment3D> &p_segment, int32_t p_parent, const Vector<float> &p_damp, float p_default_damp);
+	int32_t _add_effector(IKEffector3D *p_effector);
+	struct LevelSolve {
+		const int32_t *segments = nullptr;
+		bool constraint_mode = false;
+	};
+
+	void _build_levels();
+	void _finish_build();
+	bool _has_consistent_headings() const;
+	bool _update_effector_falloffs();
+	bool _collect_effector_falloffs(int32_t p_segment, double p_falloff, int32_t &r_segment_effector, int32_t p_segment_effector_end);
+	void _update_effector_heading_weights(int32_t p_effector);
+	void _solve_level_segment(uint32_t p_index, const LevelSolve *p_level);
+	void _update_optimal_rotation(const Step &p_step, bool p_constraint_mode);
+	void _update_target_headings();
+	void _update_heading_origins(const Segment &p_segment);
+	void _aggregate_moments(const Segment &p_segment, int32_t p_bone, QCPMoments &r_moments) const;
+	void _update_small_headings(const Segment &p_segment, int32_t p_bone, Vector3 *r_target, Vector3 *r_tip) const;
+	void _rotate_with_global(int32_t p_bone, const Quaternion &p_rotation);
+	void _update_global_poses(int32_t p_bone);
+
+public:
+	~IKSolverRig3D();
+
+	// Keeps the capacity of every array, so the rig storage is a per-instance arena: a rebuild reuses
+	// the previous build's memory and only grows it when the new rig is larger than any before it.
+	void clear();
+	void build(const Vector<Ref<IKBoneSegment3D>> &p_segmented_skeletons, const Vector<float> &p_damp, float p_default_damp);
+	// A rig built from a state has no IKBone3D graph behind it, so sync_ik_bones has nothing to write back to.
+	bool build_from_state(const ManyBoneIK3DState *p_state, Skeleton3D *p_skeleton);
+	void bake_state(ManyBoneIK3DState *r_state) const;
+	bool is_empty() const;
+	int32_t get_bone_count() const;
+	int32_t find_bone(BoneId p_bone) const;
+	int32_t find_effector(BoneId p_bone) const;
+	// Bytes of rig storage in use, and the most any build of this rig has used.
+	uint64_t get_memory_usage() const;
+	uint64_t get_memory_high_water_mark() const;
+
+	// Reads the incoming skeleton pose. A non-zero warm start keeps that fraction of the rig's previous solution.
+	void read_skeleton_poses(Skeleton3D *p_skeleton, real_t p_warm_start = 0.0);
+	// Refreshes every pin from its target node and caches the targets in skeleton space.
+	void read_effector_targets(const Transform3D &p_skeleton_global_inverse, ManyBoneIK3D *p_many_bone_ik);
+	void invalidate_effector_target_nodes();
+	void set_effector_target_node(int32_t p_effector, Skeleton3D *p_skeleton, const NodePath &p_target_node);
+	// True when the skeleton pose and the effector targets are all within p_epsilon of the inputs of the last read.
+	bool is_input_unchanged(const Skeleton3D *p_skeleton, real_t p_epsilon) const;
+	void write_skeleton_poses(Skeleton3D *p_skeleton) const;
+	void sync_ik_bones() const;
+
+	void set_bone_direction(BoneId p_bone, const Transform3D &p_transform);
+	void set_constraint_orientation(BoneId p_bone, const Transform3D &p_transform);
+	void set_constraint_twist(BoneId p_bone, const Transform3D &p_transform);
+	void set_constraint(BoneId p_bone, IKKusudama3D *p_constraint);
+	// Reweights the headings of one effector in every segment that solves for it.
+	// Returns false when the change alters the heading layout, in which case the rig has to be rebuilt.
+	bool set_effector_weights(int32_t p_effector, real_t p_weight, const Vector3 &p_direction_priorities, real_t p_motion_propagation_factor);
+
+	void solve(bool p_constraint_mode, bool p_multithreaded = false);
+	// Largest effector tip to target distance, and largest angle between a prioritized tip axis and its target axis.
+	void get_effector_errors(double &r_position_error, double &r_orientation_error) const;
+};
@@ -29,19 +29,28 @@
 /**************************************************************************/
 
 #include "many_bone_ik_3d.h"
+#include "core/config/engine.h"
 #include "core/error/error_macros.h"
 #include "core/math/math_defs.h"
 #include "core/object/class_db.h"
 #include "core/object/object.h"
+#include "core/os/os.h"
 #include "core/string/string_name.h"
+#include "core/templates/hashfuncs.h"
 #include "ik_bone_3d.h"
 #include "ik_kusudama_3d.h"
 #include "ik_open_cone_3d.h"
+#include "many_bone_ik_3d_server.h"
 #include "scene/3d/marker_3d.h"
 #include "scene/3d/skeleton_3d.h"
 #include "scene/main/node.h"
 #include "scene/main/scene_tree.h"
 
+// Pin parameters: motion propagation factor, weight and the three direction priorities.
+static const int32_t PIN_DATA_STRIDE = 5;
+// Cones: center and radius.
+static const int32_t CONE_DATA_STRIDE = 4;
+
 void ManyBoneIK3D::set_pin_count(int32_t p_value) {
 	int32_t old_count = pins.size();
 	pin_count = p_value;
@@ -49,6 +58,7 @@ void ManyBoneIK3D::set_pin_count(int32_t p_value) {
 	for (int32_t pin_i = p_value; pin_i-- > old_count;) {
 		pins.write[pin_i].instantiate();
 	}
+	property_layout_version++;
 
 	Skeleton3D *skeleton = get_skeleton();
 	ERR_FAIL_NULL(skeleton);
@@ -73,7 +83,7 @@ void ManyBoneIK3D::set_pin_count(int32_t p_value) {
 		}
 	}
 	set_dirty();
-	notify_property_list_changed();
+	_property_layout_changed();
 }
 
 int32_t ManyBoneIK3D::get_pin_count() const {
@@ -88,7 +98,7 @@ void ManyBoneIK3D::set_pin_target_node_path(int32_t p_pin_index, const NodePath
 		pins.write[p_pin_index] = effector_template;
 	}
 	effector_template->set_target_node(p_target_node);
-	set_dirty();
+	_update_pin_target_node(p_pin_index);
 }
 
 NodePath ManyBoneIK3D::get_pin_target_node_path(int32_t p_pin_index) {
@@ -107,130 +117,155 @@ void ManyBoneIK3D::_remove_pin(int32_t p_index) {
 	pin_count--;
 	pins.resize(pin_count);
 	set_dirty();
+	_property_layout_changed();
 }
 
 void ManyBoneIK3D::_update_ik_bones_transform() {
+	Skeleton3D *skeleton = get_skeleton();
+	ERR_FAIL_NULL(skeleton);
+	const Transform3D skeleton_global_inverse = skeleton->get_global_transform().affine_inverse();
 	for (int32_t bone_i = bone_list.size(); bone_i-- > 0;) {
-		Ref<IKBone3D> bone = bone_list[bone_i];
+		const Ref<IKBone3D> &bone = bone_list[bone_i];
 		if (bone.is_null()) {
 			continue;
 		}
-		bone->set_initial_pose(get_skeleton());
-		if (bone->is_pinned()) {
-			bone->get_pin()->update_target_global_transform(get_skeleton(), this);
-		}
+		bone->set_initial_pose(skeleton);
 	}
+	// The rig keeps its solved pose; the incoming skeleton pose is read right before the next solve.
+	solver_rig->read_effector_targets(skeleton_global_inverse, this);
+	// A batch result solved from the previous inputs must not be written over these.
+	_clear_batched_result();
+}
+
+void ManyBoneIK3D::_read_skeleton_poses() {
+	solver_rig->read_skeleton_poses(get_skeleton(), is_warm_start ? warm_start_factor : 0.0f);
+}
+
+bool ManyBoneIK3D::_is_asleep() const {
+	return is_sleep_mode && solver_rig->is_input_unchanged(get_skeleton(), sleep_epsilon);
 }
 
 void ManyBoneIK3D::_update_skeleton_bones_transform() {
-	for (int32_t bone_i = bone_list.size(); bone_i-- > 0;) {
-		Ref<IKBone3D> bone = bone_list[bone_i];
-		if (bone.is_null()) {
-			continue;
-		}
-		if (bone->get_bone_id() == -1) {
-			continue;
+	solver_rig->write_skeleton_poses(get_skeleton());
+	solver_rig->sync_ik_bones();
+	_update_gizmos_if_due();
+}
+
+void ManyBoneIK3D::_update_gizmos_if_due() {
+	// The editor plugin enables this for the edited node only; no other gizmo is worth redrawing while it solves.
+	if (!is_gizmo_redraw_enabled) {
+		return;
+	}
+	if (gizmo_update_rate > 0.0f) {
+		uint64_t now = OS::get_singleton()->get_ticks_usec();
+		if (now - last_gizmo_update_usec < uint64_t(1000000.0f / gizmo_update_rate)) {
+			return;
 		}
-		bone->set_skeleton_bone_pose(get_skeleton());
+		last_gizmo_update_usec = now;
 	}
 	update_gizmos();
 }
 
+void ManyBoneIK3D::set_gizmo_redraw_enabled(bool p_enabled) {
+	is_gizmo_redraw_enabled = p_enabled;
+	last_gizmo_update_usec = 0;
+}
+
 void ManyBoneIK3D::_get_property_list(List<PropertyInfo> *p_list) const {
-	const Vector<Ref<IKBone3D>> ik_bones = get_bone_list();
-	RBSet<StringName> existing_pins;
-	for (int32_t pin_i = 0; pin_i < get_pin_count(); pin_i++) {
-		const String bone_name = get_pin_bone_name(pin_i);
-		existing_pins.insert(bone_name);
-	}
-	const uint32_t pin_usage = PROPERTY_USAGE_DEFAULT;
-	p_list->push_back(
+	Skeleton3D *skeleton = get_skeleton();
+	ObjectID skeleton_id = skeleton ? skeleton->get_instance_id() : ObjectID();
+	uint64_t skeleton_version = skeleton ? skeleton->get_version() : 0;
+	if (property_list_cache_layout_version != property_layout_version || property_list_cache_skeleton != skeleton_id || property_list_cache_skeleton_version != skeleton_version) {
+		_update_property_list_cache();
+		property_list_cache_layout_version = property_layout_version;
+		property_list_cache_skeleton = skeleton_id;
+		property_list_cache_skeleton_version = skeleton_version;
+	}
+	for (const PropertyInfo &property : property_list_cache) {
+		p_list->push_back(property);
+	}
+}
+
+void ManyBoneIK3D::_property_layout_changed() {
+	property_layout_version++;
+	notify_property_list_changed();
+}
+
+void ManyBoneIK3D::_update_property_list_cache() const {
+	property_list_cache.clear();
+	Skeleton3D *skeleton = get_skeleton();
+	// Every pin offers the bones that are not pinned yet and every constraint offers all bones, so both hints are built once.
+	String pin_bone_names;
+	String constraint_bone_names;
+	if (skeleton) {
+		RBSet<StringName> existing_pins;
+		for (int32_t pin_i = 0; pin_i < get_pin_count(); pin_i++) {
+			existing_pins.insert(get_pin_bone_name(pin_i));
+		}
+		for (int bone_i = 0; bone_i < skeleton->get_bone_count(); bone_i++) {
+			String name = skeleton->get_bone_name(bone_i) + ",";
+			constraint_bone_names += name;
+			if (!existing_pins.has(skeleton->get_bone_name(bone_i))) {
+				pin_bone_names += name;
+			}
+		}
+	}
+	const PropertyHint bone_name_hint = skeleton ? PROPERTY_HINT_ENUM_SUGGESTION : PROPERTY_HINT_NONE;
+
+	// In packed storage mode the per field properties stay editable, while pin_data and constraint_data are what gets saved.
+	const uint32_t pin_usage = is_packed_storage ? PROPERTY_USAGE_EDITOR : PROPERTY_USAGE_DEFAULT;
+	property_list_cache.push_back(
 			PropertyInfo(Variant::INT, "pin_count",
 					PROPERTY_HINT_RANGE, "0,65536,or_greater", pin_usage | PROPERTY_USAGE_ARRAY | PROPERTY_USAGE_READ_ONLY,
 					"Pins,pins/"));
 	for (int pin_i = 0; pin_i < get_pin_count(); pin_i++) {
-		PropertyInfo effector_name;
-		effector_name.type = Variant::STRING_NAME;
-		effector_name.name = "pins/" + itos(pin_i) + "/bone_name";
-		effector_name.usage = pin_usage;
-		if (get_skeleton()) {
-			String names;
-			for (int bone_i = 0; bone_i < get_skeleton()->get_bone_count(); bone_i++) {
-				String name = get_skeleton()->get_bone_name(bone_i);
-				StringName string_name = StringName(name);
-				if (existing_pins.has(string_name)) {
-					continue;
-				}
-				name += ",";
-				names += name;
-				existing_pins.insert(name);
-			}
-			effector_name.hint = PROPERTY_HINT_ENUM_SUGGESTION;
-			effector_name.hint_string = names;
-		} else {
-			effector_name.hint = PROPERTY_HINT_NONE;
-			effector_name.hint_string = "";
-		}
-		p_list->push_back(effector_name);
-		p_list->push_back(
+		property_list_cache.push_back(
+				PropertyInfo(Variant::STRING_NAME, "pins/" + itos(pin_i) + "/bone_name", bone_name_hint, pin_bone_names, pin_usage));
+		property_list_cache.push_back(
 				PropertyInfo(Variant::NODE_PATH, "pins/" + itos(pin_i) + "/target_node", PROPERTY_HINT_NODE_PATH_VALID_TYPES, "Node3D", pin_usage));
-		p_list->push_back(
+		property_list_cache.push_back(
 				PropertyInfo(Variant::FLOAT, "pins/" + itos(pin_i) + "/motion_propagation_factor", PROPERTY_HINT_RANGE, "0,1,0.1,or_greater", pin_usage));
-		p_list->push_back(
+		property_list_cache.push_back(
 				PropertyInfo(Variant::FLOAT, "pins/" + itos(pin_i) + "/weight", PROPERTY_HINT_RANGE, "0,1,0.1,or_greater", pin_usage));
-		p_list->push_back(
+		property_list_cache.push_back(
 				PropertyInfo(Variant::VECTOR3, "pins/" + itos(pin_i) + "/direction_priorities", PROPERTY_HINT_RANGE, "0,1,0.1,or_greater", pin_usage));
 	}
-	uint32_t constraint_usage = PROPERTY_USAGE_DEFAULT;
-	p_list->push_back(
+	uint32_t constraint_usage = is_packed_storage ? PROPERTY_USAGE_EDITOR : PROPERTY_USAGE_DEFAULT;
+	property_list_cache.push_back(
 			PropertyInfo(Variant::INT, "constraint_count",
 					PROPERTY_HINT_RANGE, "0,256,or_greater", constraint_usage | PROPERTY_USAGE_ARRAY | PROPERTY_USAGE_READ_ONLY,
 					"Kusudama Constraints,constraints/"));
-	RBSet<String> existing_constraints;
 	for (int constraint_i = 0; constraint_i < get_constraint_count(); constraint_i++) {
-		PropertyInfo bone_name;
-		bone_name.type = Variant::STRING_NAME;
-		bone_name.usage = constraint_usage;
-		bone_name.name = "constraints/" + itos(constraint_i) + "/bone_name";
-		if (get_skeleton()) {
-			String names;
-			for (int bone_i = 0; bone_i < get_skeleton()->get_bone_count(); bone_i++) {
-				String name = get_skeleton()->get_bone_name(bone_i);
-				if (existing_constraints.has(name)) {
-					continue;
-				}
-				name += ",";
-				names += name;
-				existing_constraints.insert(name);
-			}
-			bone_name.hint = PROPERTY_HINT_ENUM_SUGGESTION;
-			bone_name.hint_string = names;
-		} else {
-			bone_name.hint = PROPERTY_HINT_NONE;
-			bone_name.hint_string = "";
-		}
-		p_list->push_back(bone_name);
-		p_list->push_back(
+		property_list_cache.push_back(
+				PropertyInfo(Variant::STRING_NAME, "constraints/" + itos(constraint_i) + "/bone_name", bone_name_hint, constraint_bone_names, constraint_usage));
+		property_list_cache.push_back(
 				PropertyInfo(Variant::FLOAT, "constraints/" + itos(constraint_i) + "/twist_start", PROPERTY_HINT_RANGE, "-359.9,359.9,0.1,radians,exp", constraint_usage));
-		p_list->push_back(
+		property_list_cache.push_back(
 				PropertyInfo(Variant::FLOAT, "constraints/" + itos(constraint_i) + "/twist_end", PROPERTY_HINT_RANGE, "-359.9,359.9,0.1,radians,exp", constraint_usage));
-		p_list->push_back(
+		property_list_cache.push_back(
 				PropertyInfo(Variant::INT, "constraints/" + itos(constraint_i) + "/kusudama_open_cone_count", PROPERTY_HINT_RANGE, "0,10,1", constraint_usage | PROPERTY_USAGE_ARRAY | PROPERTY_USAGE_READ_ONLY,
 						"Limit Cones,constraints/" + itos(constraint_i) + "/kusudama_open_cone/"));
 		for (int cone_i = 0; cone_i < get_kusudama_open_cone_count(constraint_i); cone_i++) {
-			p_list->push_back(
+			property_list_cache.push_back(
 					PropertyInfo(Variant::VECTOR3, "constraints/" + itos(constraint_i) + "/kusudama_open_cone/" + itos(cone_i) + "/center", PROPERTY_HINT_RANGE, "-1,1,0.1,exp", constraint_usage));
 
-			p_list->push_back(
+			property_list_cache.push_back(
 					PropertyInfo(Variant::FLOAT, "constraints/" + itos(constraint_i) + "/kusudama_open_cone/" + itos(cone_i) + "/radius", PROPERTY_HINT_RANGE, "0,180,0.1,radians,exp", constraint_usage));
 		}
-		p_list->push_back(
+		if (is_packed_storage) {
+			continue;
+		}
+		property_list_cache.push_back(
 				PropertyInfo(Variant::TRANSFORM3D, "constraints/" + itos(constraint_i) + "/kusudama_twist", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_STORAGE));
-		p_list->push_back(
+		property_list_cache.push_back(
 				PropertyInfo(Variant::TRANSFORM3D, "constraints/" + itos(constraint_i) + "/kusudama_orientation", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_STORAGE));
-		p_list->push_back(
+		property_list_cache.push_back(
 				PropertyInfo(Variant::TRANSFORM3D, "constraints/" + itos(constraint_i) + "/bone_direction", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_STORAGE));
 	}
+	if (is_packed_storage) {
+		property_list_cache.push_back(PropertyInfo(Variant::DICTIONARY, "pin_data", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_STORAGE));
+		property_list_cache.push_back(PropertyInfo(Variant::DICTIONARY, "constraint_data", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_STORAGE));
+	}
 }
 
 bool ManyBoneIK3D::_get(const StringName &p_name, Variant &r_ret) const {
@@ -244,6 +279,12 @@ bool ManyBoneIK3D::_get(const StringName &p_name, Variant &r_ret) const {
 	} else if (name == "bone_count") {
 		r_ret = get_bone_count();
 		return true;
+	} else if (name == "pin_data") {
+		r_ret = _get_pin_data();
+		return true;
+	} else if (name == "constraint_data") {
+		r_ret = _get_constraint_data();
+		return true;
 	} else if (name.begins_with("pins/")) {
 		int index = name.get_slicec('/', 1).to_int();
 		String what = name.get_slicec('/', 2);
@@ -296,13 +337,13 @@ bool ManyBoneIK3D::_get(const StringName &p_name, Variant &r_ret) const {
 				return true;
 			}
 		} else if (what == "bone_direction") {
-			r_ret = get_direction_transform_of_bone(index);
+			r_ret = _get_saved_constraint_transform(index, constraint_transforms[index].has_bone_direction, get_direction_transform_of_bone(index));
 			return true;
 		} else if (what == "kusudama_orientation") {
-			r_ret = get_orientation_transform_of_constraint(index);
+			r_ret = _get_saved_constraint_transform(index, constraint_transforms[index].has_orientation, get_orientation_transform_of_constraint(index));
 			return true;
 		} else if (what == "kusudama_twist") {
-			r_ret = get_twist_transform_of_constraint(index);
+			r_ret = _get_saved_constraint_transform(index, constraint_transforms[index].has_twist, get_twist_transform_of_constraint(index));
 			return true;
 		}
 	}
@@ -317,6 +358,12 @@ bool ManyBoneIK3D::_set(const StringName &p_name, const Variant &p_value) {
 	} else if (name == "pin_count") {
 		set_pin_count(p_value);
 		return true;
+	} else if (name == "pin_data") {
+		_set_pin_data(p_value);
+		return true;
+	} else if (name == "constraint_data") {
+		_set_constraint_data(p_value);
+		return true;
 	} else if (name.begins_with("pins/")) {
 		int index = name.get_slicec('/', 1).to_int();
 		String what = name.get_slicec('/', 2);
@@ -370,6 +417,9 @@ bool ManyBoneIK3D::_set(const StringName &p_name, const Variant &p_value) {
 				set_kusudama_open_cone_radius(index, cone_index, p_value);
 				return true;
 			}
+		} else if (p_value.get_type() == Variant::NIL && (what == "bone_direction" || what == "kusudama_orientation" || what == "kusudama_twist")) {
+			// Saved before the transform had a value, so the rig's default is kept.
+			return true;
 		} else if (what == "bone_direction") {
 			set_direction_transform_of_bone(index, p_value);
 			return true;
@@ -431,6 +481,39 @@ void ManyBoneIK3D::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("get_bone_count"), &ManyBoneIK3D::get_bone_count);
 	ClassDB::bind_method(D_METHOD("set_constraint_mode", "enabled"), &ManyBoneIK3D::set_constraint_mode);
 	ClassDB::bind_method(D_METHOD("get_constraint_mode"), &ManyBoneIK3D::get_constraint_mode);
+	ClassDB::bind_method(D_METHOD("set_multithreaded_solve", "enabled"), &ManyBoneIK3D::set_multithreaded_solve);
+	ClassDB::bind_method(D_METHOD("get_multithreaded_solve"), &ManyBoneIK3D::get_multithreaded_solve);
+	ClassDB::bind_method(D_METHOD("set_batched_solve", "enabled"), &ManyBoneIK3D::set_batched_solve);
+	ClassDB::bind_method(D_METHOD("get_batched_solve"), &ManyBoneIK3D::get_batched_solve);
+	ClassDB::bind_method(D_METHOD("set_tolerance_mode", "enabled"), &ManyBoneIK3D::set_tolerance_mode);
+	ClassDB::bind_method(D_METHOD("get_tolerance_mode"), &ManyBoneIK3D::get_tolerance_mode);
+	ClassDB::bind_method(D_METHOD("set_position_tolerance", "tolerance"), &ManyBoneIK3D::set_position_tolerance);
+	ClassDB::bind_method(D_METHOD("get_position_tolerance"), &ManyBoneIK3D::get_position_tolerance);
+	ClassDB::bind_method(D_METHOD("set_orientation_tolerance", "tolerance"), &ManyBoneIK3D::set_orientation_tolerance);
+	ClassDB::bind_method(D_METHOD("get_orientation_tolerance"), &ManyBoneIK3D::get_orientation_tolerance);
+	ClassDB::bind_method(D_METHOD("get_last_iteration_count"), &ManyBoneIK3D::get_last_iteration_count);
+	ClassDB::bind_method(D_METHOD("get_last_position_error"), &ManyBoneIK3D::get_last_position_error);
+	ClassDB::bind_method(D_METHOD("get_last_orientation_error"), &ManyBoneIK3D::get_last_orientation_error);
+	ClassDB::bind_method(D_METHOD("set_warm_start", "enabled"), &ManyBoneIK3D::set_warm_start);
+	ClassDB::bind_method(D_METHOD("get_warm_start"), &ManyBoneIK3D::get_warm_start);
+	ClassDB::bind_method(D_METHOD("set_warm_start_factor", "factor"), &ManyBoneIK3D::set_warm_start_factor);
+	ClassDB::bind_method(D_METHOD("get_warm_start_factor"), &ManyBoneIK3D::get_warm_start_factor);
+	ClassDB::bind_method(D_METHOD("set_sleep_mode", "enabled"), &ManyBoneIK3D::set_sleep_mode);
+	ClassDB::bind_method(D_METHOD("get_sleep_mode"), &ManyBoneIK3D::get_sleep_mode);
+	ClassDB::bind_method(D_METHOD("set_sleep_epsilon", "epsilon"), &ManyBoneIK3D::set_sleep_epsilon);
+	ClassDB::bind_method(D_METHOD("get_sleep_epsilon"), &ManyBoneIK3D::get_sleep_epsilon);
+	ClassDB::bind_method(D_METHOD("get_skipped_frame_count"), &ManyBoneIK3D::get_skipped_frame_count);
+	ClassDB::bind_method(D_METHOD("get_rig_memory_high_water_mark"), &ManyBoneIK3D::get_rig_memory_high_water_mark);
+	ClassDB::bind_method(D_METHOD("set_state", "state"), &ManyBoneIK3D::set_state);
+	ClassDB::bind_method(D_METHOD("get_state"), &ManyBoneIK3D::get_state);
+	ClassDB::bind_method(D_METHOD("bake_state"), &ManyBoneIK3D::bake_state);
+	ClassDB::bind_method(D_METHOD("set_gizmo_update_rate", "rate"), &ManyBoneIK3D::set_gizmo_update_rate);
+	ClassDB::bind_method(D_METHOD("get_gizmo_update_rate"), &ManyBoneIK3D::get_gizmo_update_rate);
+	ClassDB::bind_method(D_METHOD("set_packed_storage", "enabled"), &ManyBoneIK3D::set_packed_storage);
+	ClassDB::bind_method(D_METHOD("get_packed_storage"), &ManyBoneIK3D::get_packed_storage);
+	ClassDB::bind_method(D_METHOD("set_synchronous_rebuild", "enabled"), &ManyBoneIK3D::set_synchronous_rebuild);
+	ClassDB::bind_method(D_METHOD("get_synchronous_rebuild"), &ManyBoneIK3D::get_synchronous_rebuild);
+	ClassDB::bind_method(D_METHOD("is_rebuilding_rig"), &ManyBoneIK3D::is_rebuilding_rig);
 	ClassDB::bind_method(D_METHOD("set_ui_selected_bone", "bone"), &ManyBoneIK3D::set_ui_selected_bone);
 	ClassDB::bind_method(D_METHOD("get_ui_selected_bone"), &ManyBoneIK3D::get_ui_selected_bone);
 	ClassDB::bind_method(D_METHOD("set_stabilization_passes", "passes"), &ManyBoneIK3D::set_stabilization_passes);
@@ -440,14 +523,31 @@ void ManyBoneIK3D::_bind_methods() {
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "iterations_per_frame", PROPERTY_HINT_RANGE, "1,150,1,or_greater"), "set_iterations_per_frame", "get_iterations_per_frame");
 	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "default_damp", PROPERTY_HINT_RANGE, "0.01,180.0,0.1,radians,exp", PROPERTY_USAGE_DEFAULT | PROPERTY_USAGE_UPDATE_ALL_IF_MODIFIED), "set_default_damp", "get_default_damp");
 	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "constraint_mode"), "set_constraint_mode", "get_constraint_mode");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "multithreaded_solve"), "set_multithreaded_solve", "get_multithreaded_solve");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "batched_solve"), "set_batched_solve", "get_batched_solve");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "tolerance_mode"), "set_tolerance_mode", "get_tolerance_mode");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "position_tolerance", PROPERTY_HINT_RANGE, "0,1,0.0001,or_greater,suffix:m"), "set_position_tolerance", "get_position_tolerance");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "orientation_tolerance", PROPERTY_HINT_RANGE, "0,180,0.01,radians"), "set_orientation_tolerance", "get_orientation_tolerance");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "warm_start"), "set_warm_start", "get_warm_start");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "warm_start_factor", PROPERTY_HINT_RANGE, "0,1,0.01"), "set_warm_start_factor", "get_warm_start_factor");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "sleep_mode"), "set_sleep_mode", "get_sleep_mode");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "sleep_epsilon", PROPERTY_HINT_RANGE, "0,0.01,0.000001,or_greater"), "set_sleep_epsilon", "get_sleep_epsilon");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "gizmo_update_rate", PROPERTY_HINT_RANGE, "0,120,1,or_greater,suffix:Hz"), "set_gizmo_update_rate", "get_gizmo_update_rate");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "packed_storage"), "set_packed_storage", "get_packed_storage");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "synchronous_rebuild"), "set_synchronous_rebuild", "get_synchronous_rebuild");
+	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "state", PROPERTY_HINT_RESOURCE_TYPE, "ManyBoneIK3DState"), "set_state", "get_state");
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "ui_selected_bone", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NO_EDITOR), "set_ui_selected_bone", "get_ui_selected_bone");
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "stabilization_passes"), "set_stabilization_passes", "get_stabilization_passes");
+
+	ADD_SIGNAL(MethodInfo("rig_rebuilt"));
 }
 
 ManyBoneIK3D::ManyBoneIK3D() {
+	rig_build.solver_rig = &solver_rigs[1];
 }
 
 ManyBoneIK3D::~ManyBoneIK3D() {
+	_cancel_rig_build();
 }
 
 float ManyBoneIK3D::get_pin_motion_propagation_factor(int32_t p_effector_index) const {
@@ -461,25 +561,28 @@ void ManyBoneIK3D::set_pin_motion_propagation_factor(int32_t p_effector_index, c
 	Ref<IKEffectorTemplate3D> effector_template = pins[p_effector_index];
 	ERR_FAIL_COND(effector_template.is_null());
 	effector_template->set_motion_propagation_factor(p_motion_propagation_factor);
-	set_dirty();
+	_set_weights_dirty(p_effector_index);
 }
 
 void ManyBoneIK3D::_set_constraint_count(int32_t p_count) {
 	int32_t old_count = constraint_names.size();
 	constraint_count = p_count;
+	constraint_kusudamas.resize(p_count);
 	constraint_names.resize(p_count);
 	joint_twist.resize(p_count);
 	kusudama_open_cone_count.resize(p_count);
 	kusudama_open_cones.resize(p_count);
+	constraint_transforms.resize(p_count);
 	for (int32_t constraint_i = p_count; constraint_i-- > old_count;) {
 		constraint_names.write[constraint_i] = String();
+		constraint_transforms[constraint_i] = ConstraintTransforms();
 		kusudama_open_cone_count.write[constraint_i] = 0;
 		kusudama_open_cones.write[constraint_i].resize(1);
 		kusudama_open_cones.write[constraint_i].write[0] = Vector4(0, 1, 0, 0.01745f);
 		joint_twist.write[constraint_i] = Vector2(0, 0.01745f);
 	}
 	set_dirty();
-	notify_property_list_changed();
+	_property_layout_changed();
 }
 
 int32_t ManyBoneIK3D::get_constraint_count() const {
@@ -499,7 +602,7 @@ Vector2 ManyBoneIK3D::get_joint_twist(int32_t p_index) const {
 void ManyBoneIK3D::set_joint_twist(int32_t p_index, Vector2 p_to) {
 	ERR_FAIL_INDEX(p_index, constraint_count);
 	joint_twist.write[p_index] = p_to;
-	set_dirty();
+	_set_constraint_dirty(p_index);
 }
 
 int32_t ManyBoneIK3D::find_pin_id(StringName p_bone_name) {
@@ -526,7 +629,7 @@ void ManyBoneIK3D::set_kusudama_open_cone(int32_t p_constraint_index, int32_t p_
 	cone.w = p_radius;
 	cones.write[p_index] = cone;
 	kusudama_open_cones.write[p_constraint_index] = cones;
-	set_dirty();
+	_set_constraint_dirty(p_constraint_index);
 }
 
 float ManyBoneIK3D::get_kusudama_open_cone_radius(int32_t p_constraint_index, int32_t p_index) const {
@@ -557,8 +660,8 @@ void ManyBoneIK3D::set_kusudama_open_cone_count(int32_t p_constraint_index, int3
 		cone.z = forward_axis.z;
 		cone.w = Math::deg_to_rad(0.0f);
 	}
-	set_dirty();
-	notify_property_list_changed();
+	_set_constraint_dirty(p_constraint_index);
+	_property_layout_changed();
 }
 
 real_t ManyBoneIK3D::get_default_damp() const {
@@ -583,7 +686,7 @@ void ManyBoneIK3D::set_kusudama_open_cone_radius(int32_t p_effector_index, int32
 	ERR_FAIL_INDEX(p_index, kusudama_open_cones[p_effector_index].size());
 	Vector4 &cone = kusudama_open_cones.write[p_effector_index].write[p_index];
 	cone.w = p_radius;
-	set_dirty();
+	_set_constraint_dirty(p_effector_index);
 }
 
 void ManyBoneIK3D::set_kusudama_open_cone_center(int32_t p_effector_index, int32_t p_index, Vector3 p_center) {
@@ -599,7 +702,7 @@ void ManyBoneIK3D::set_kusudama_open_cone_center(int32_t p_effector_index, int32
 		cone.y = p_center.y;
 		cone.z = p_center.z;
 	}
-	set_dirty();
+	_set_constraint_dirty(p_effector_index);
 }
 
 Vector3 ManyBoneIK3D::get_kusudama_open_cone_center(int32_t p_constraint_index, int32_t p_index) const {
@@ -622,6 +725,8 @@ Vector3 ManyBoneIK3D::get_kusudama_open_cone_center(int32_t p_constraint_index,
 void ManyBoneIK3D::set_constraint_name_at_index(int32_t p_index, String p_name) {
 	ERR_FAIL_INDEX(p_index, constraint_names.size());
 	constraint_names.write[p_index] = p_name;
+	// The transforms were set for the previous bone.
+	constraint_transforms[p_index] = ConstraintTransforms();
 	set_dirty();
 }
 
@@ -657,12 +762,29 @@ void ManyBoneIK3D::_process_modification(double p_delta) {
 	if (!get_skeleton()) {
 		return;
 	}
-	if (!segmented_skeletons.size()) {
+	if (_is_rig_build_completed()) {
+		_apply_rig_build();
+	}
+	if (solver_rig->is_empty()) {
 		set_dirty();
 	}
-	if (is_dirty) {
+	if (is_dirty && !is_rebuilding_rig()) {
 		is_dirty = false;
-		_bone_list_changed();
+		// At runtime a rig that can still solve keeps doing so while its replacement is built on a worker.
+		bool is_background = !is_synchronous_rebuild && !Engine::get_singleton()->is_editor_hint() && !solver_rig->is_empty() && !is_rig_from_state;
+		if (is_background && !_apply_state()) {
+			if (_prepare_rig_build(true)) {
+				rig_build_task = WorkerThreadPool::get_singleton()->add_template_task(this, &ManyBoneIK3D::_build_rig, &rig_build, false, SNAME("ManyBoneIK3DRigBuild"));
+			}
+		} else if (!is_background) {
+			_bone_list_changed();
+		}
+	} else if (!is_rebuilding_rig()) {
+		// Weight and constraint edits made during a rebuild are already in its inputs, or patch the new rig after the swap.
+		_update_dirty_parameters();
+	}
+	if (solver_rig->is_empty()) {
+		return;
 	}
 	if (bone_list.size()) {
 		Ref<IKNode3D> root_ik_bone = bone_list.write[0]->get_ik_transform();
@@ -680,15 +802,122 @@ void ManyBoneIK3D::_process_modification(double p_delta) {
 	if (!is_visible()) {
 		return;
 	}
+	if (!_has_batched_result() && is_batched_solve && ManyBoneIK3DServer::get_singleton()) {
+		ManyBoneIK3DServer::get_singleton()->solve_batch();
+	}
+	if (_has_batched_result()) {
+		_clear_batched_result();
+	} else if (_is_asleep()) {
+		// Nothing moved, so the pose still held by the rig is re-emitted as is.
+		last_iteration_count = 0;
+		skipped_frame_count++;
+	} else {
+		_read_skeleton_poses();
+		_solve(get_multithreaded_solve());
+	}
+	last_solve_process_frame = Engine::get_singleton()->get_process_frames();
+	last_solve_physics_frame = Engine::get_singleton()->get_physics_frames();
+	_update_skeleton_bones_transform();
+}
+
+void ManyBoneIK3D::_solve(bool p_multithreaded) {
+	// In tolerance mode iterations_per_frame is the upper bound, and the solve stops as soon as every effector is close enough.
+	last_iteration_count = 0;
+	last_position_error = 0.0;
+	last_orientation_error = 0.0;
+	if (is_tolerance_mode) {
+		solver_rig->get_effector_errors(last_position_error, last_orientation_error);
+	}
 	for (int32_t i = 0; i < get_iterations_per_frame(); i++) {
-		for (Ref<IKBoneSegment3D> segmented_skeleton : segmented_skeletons) {
-			if (segmented_skeleton.is_null()) {
-				continue;
-			}
-			segmented_skeleton->segment_solver(bone_damp, get_default_damp(), get_constraint_mode(), i, get_iterations_per_frame());
+		if (is_tolerance_mode && last_position_error <= position_tolerance && last_orientation_error <= orientation_tolerance) {
+			break;
+		}
+		solver_rig->solve(get_constraint_mode(), p_multithreaded);
+		last_iteration_count++;
+		if (is_tolerance_mode) {
+			solver_rig->get_effector_errors(last_position_error, last_orientation_error);
 		}
 	}
-	_update_skeleton_bones_transform();
+}
+
+bool ManyBoneIK3D::_begin_batched_solve() {
+	// Mirrors the early outs of _process_modification, so only instances that would solve anyway join a batch.
+	if (_has_batched_result() || is_dirty || solver_rig->is_empty() || _is_rig_build_completed()) {
+		return false;
+	}
+	if (!get_skeleton() || !is_enabled() || !is_visible()) {
+		return false;
+	}
+	if (!_is_first_enabled_modifier()) {
+		return false;
+	}
+	if (bone_list.size() && (bone_list[0].is_null() || bone_list[0]->get_ik_transform().is_null())) {
+		return false;
+	}
+	// Already solved this tick; joining now would solve the next tick from this tick's pose.
+	if (last_solve_process_frame == Engine::get_singleton()->get_process_frames() && last_solve_physics_frame == Engine::get_singleton()->get_physics_frames()) {
+		return false;
+	}
+	if (_is_asleep()) {
+		return false;
+	}
+	_read_skeleton_poses();
+	batched_result_process_frame = Engine::get_singleton()->get_process_frames();
+	batched_result_physics_frame = Engine::get_singleton()->get_physics_frames();
+	return true;
+}
+
+bool ManyBoneIK3D::_has_batched_result() const {
+	// A node whose modification did not run in the tick it was batched in must not write that result later.
+	return batched_result_process_frame == Engine::get_singleton()->get_process_frames() && batched_result_physics_frame == Engine::get_singleton()->get_physics_frames();
+}
+
+void ManyBoneIK3D::_clear_batched_result() {
+	batched_result_process_frame = UINT64_MAX;
+	batched_result_physics_frame = UINT64_MAX;
+}
+
+bool ManyBoneIK3D::_is_first_enabled_modifier() const {
+	// Skeleton3D runs its modifiers in child order. Before an earlier enabled one has run, the skeleton does not hold this node's input pose yet.
+	Skeleton3D *skeleton = get_skeleton();
+	if (!skeleton || get_parent() != skeleton) {
+		return false;
+	}
+	for (int32_t child_i = 0; child_i < get_index(); child_i++) {
+		SkeletonModifier3D *modifier = Object::cast_to<SkeletonModifier3D>(skeleton->get_child(child_i));
+		if (modifier && modifier->is_enabled()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void ManyBoneIK3D::_notification(int p_what) {
+	switch (p_what) {
+		case NOTIFICATION_ENTER_TREE: {
+			if (is_batched_solve && ManyBoneIK3DServer::get_singleton()) {
+				ManyBoneIK3DServer::get_singleton()->register_instance(this);
+			}
+			// Target paths are relative to this node, so they may point elsewhere once it moves.
+			_invalidate_pin_target_nodes();
+		} break;
+		case NOTIFICATION_EXIT_TREE: {
+			if (is_batched_solve && ManyBoneIK3DServer::get_singleton()) {
+				ManyBoneIK3DServer::get_singleton()->unregister_instance(this);
+			}
+			_clear_batched_result();
+			if (is_rebuilding_rig()) {
+				// The changes the build was for are rebuilt on the next modification instead.
+				_cancel_rig_build();
+				is_dirty = true;
+			}
+			_invalidate_pin_target_nodes();
+		} break;
+	}
+}
+
+void ManyBoneIK3D::_invalidate_pin_target_nodes() {
+	solver_rig->invalidate_effector_target_nodes();
 }
 
 real_t ManyBoneIK3D::get_pin_weight(int32_t p_pin_index) const {
@@ -705,7 +934,7 @@ void ManyBoneIK3D::set_pin_weight(int32_t p_pin_index, const real_t &p_weight) {
 		pins.write[p_pin_index] = effector_template;
 	}
 	effector_template->set_weight(p_weight);
-	set_dirty();
+	_set_weights_dirty(p_pin_index);
 }
 
 Vector3 ManyBoneIK3D::get_pin_direction_priorities(int32_t p_pin_index) const {
@@ -722,11 +951,153 @@ void ManyBoneIK3D::set_pin_direction_priorities(int32_t p_pin_index, const Vecto
 		pins.write[p_pin_index] = effector_template;
 	}
 	effector_template->set_direction_priorities(p_priority_direction);
-	set_dirty();
+	_set_weights_dirty(p_pin_index);
 }
 
 void ManyBoneIK3D::set_dirty() {
 	is_dirty = true;
+	if (is_rig_from_state) {
+		is_state_outdated = true;
+	}
+}
+
+void ManyBoneIK3D::_set_weights_dirty(int32_t p_pin_index) {
+	if (is_rig_from_state) {
+		// There is no graph to patch the weights of.
+		set_dirty();
+		return;
+	}
+	if (!dirty_pins.has(p_pin_index)) {
+		dirty_pins.push_back(p_pin_index);
+	}
+}
+
+void ManyBoneIK3D::_update_pin_target_node(int32_t p_pin_index) {
+	if (is_rig_from_state) {
+		set_dirty();
+		return;
+	}
+	// A pending rebuild reads the path from the pin, and a running one has it reapplied after the swap.
+	Skeleton3D *skeleton = get_skeleton();
+	if (!skeleton || is_dirty || is_rebuilding_rig() || p_pin_index >= int32_t(pin_effectors.size()) || pin_effectors[p_pin_index] == -1) {
+		return;
+	}
+	solver_rig->set_effector_target_node(pin_effectors[p_pin_index], skeleton, pins[p_pin_index]->get_target_node());
+}
+
+void ManyBoneIK3D::_set_constraint_dirty(int32_t p_constraint_index) {
+	if (is_rig_from_state) {
+		set_dirty();
+		return;
+	}
+	if (!dirty_constraints.has(p_constraint_index)) {
+		dirty_constraints.push_back(p_constraint_index);
+	}
+}
+
+void ManyBoneIK3D::_update_dirty_parameters() {
+	if (!dirty_pins.is_empty()) {
+		bool is_updated = _update_pin_weights();
+		dirty_pins.clear();
+		if (!is_updated) {
+			// A priority or propagation change moved headings between pins, which needs the full rebuild.
+			_bone_list_changed();
+			return;
+		}
+	}
+	if (!dirty_constraints.is_empty()) {
+		_update_dirty_constraints();
+	}
+}
+
+bool ManyBoneIK3D::_update_pin_weights() {
+	if (solver_rig->is_empty()) {
+		return false;
+	}
+	for (int32_t pin_i : dirty_pins) {
+		// A pin without an effector has no headings to reweight.
+		if (pin_i < 0 || pin_i >= pins.size() || pin_i >= int32_t(pin_effectors.size()) || pin_effectors[pin_i] == -1) {
+			continue;
+		}
+		const Ref<IKEffectorTemplate3D> &pin = pins[pin_i];
+		if (pin.is_null()) {
+			continue;
+		}
+		if (!solver_rig->set_effector_weights(pin_effectors[pin_i], pin->get_weight(), pin->get_direction_priorities(), pin->get_motion_propagation_factor())) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void ManyBoneIK3D::_update_dirty_constraints() {
+	Skeleton3D *skeleton = get_skeleton();
+	ERR_FAIL_NULL(skeleton);
+	for (int32_t constraint_i : dirty_constraints) {
+		if (constraint_i < 0 || constraint_i >= constraint_count) {
+			continue;
+		}
+		BoneId bone_id = skeleton->find_bone(constraint_names[constraint_i]);
+		Ref<IKBone3D> ik_bone_3d = find_ik_bone(bone_id);
+		if (ik_bone_3d.is_null()) {
+			continue;
+		}
+		Ref<IKKusudama3D> constraint = _create_constraint(constraint_i, ik_bone_3d);
+		_apply_constraint_transforms(constraint_transforms[constraint_i], ik_bone_3d);
+		solver_rig->set_constraint(bone_id, constraint.ptr());
+		solver_rig->set_constraint_twist(bone_id, ik_bone_3d->get_constraint_twist_transform()->get_transform());
+	}
+	dirty_constraints.clear();
+}
+
+Ref<IKKusudama3D> ManyBoneIK3D::_create_constraint(int32_t p_constraint_index, const Ref<IKBone3D> &p_bone) {
+	if (constraint_kusudamas.size() < uint32_t(constraint_count)) {
+		constraint_kusudamas.resize(constraint_count);
+	}
+	Ref<IKKusudama3D> &constraint = constraint_kusudamas[p_constraint_index];
+	_configure_constraint(constraint, kusudama_open_cone_count[p_constraint_index], kusudama_open_cones[p_constraint_index], get_joint_twist(p_constraint_index), p_bone);
+	return constraint;
+}
+
+void ManyBoneIK3D::_configure_constraint(Ref<IKKusudama3D> &r_constraint, int32_t p_cone_count, const Vector<Vector4> &p_cones, const Vector2 &p_axial_limit, const Ref<IKBone3D> &p_bone) {
+	if (r_constraint.is_null()) {
+		r_constraint.instantiate();
+	}
+	r_constraint->enable_orientational_limits();
+
+	r_constraint->resize_open_cones(p_cone_count);
+	for (int32_t cone_i = 0; cone_i < p_cone_count; ++cone_i) {
+		const Vector4 &cone = p_cones[cone_i];
+		Ref<IKLimitCone3D> open_cone = r_constraint->get_open_cone(cone_i);
+		open_cone->set_radius(MAX(1.0e-38, cone.w));
+		open_cone->set_control_point(Vector3(cone.x, cone.y, cone.z).normalized());
+	}
+
+	r_constraint->enable_axial_limits();
+	r_constraint->set_axial_limits(p_axial_limit.x, p_axial_limit.y);
+	p_bone->add_constraint(r_constraint);
+	// Also updates the tangent radii and bakes the cones.
+	r_constraint->_update_constraint(p_bone->get_constraint_twist_transform());
+}
+
+uint32_t ManyBoneIK3D::_get_skeleton_topology_hash() const {
+	Skeleton3D *skeleton = get_skeleton();
+	if (!skeleton) {
+		return 0;
+	}
+	uint32_t hash = hash_murmur3_one_32(skeleton->get_bone_count());
+	for (int32_t bone_i = 0; bone_i < skeleton->get_bone_count(); bone_i++) {
+		hash = hash_murmur3_one_32(skeleton->get_bone_name(bone_i).hash(), hash);
+		hash = hash_murmur3_one_32(skeleton->get_bone_parent(bone_i), hash);
+	}
+	return hash_fmix32(hash);
+}
+
+void ManyBoneIK3D::_on_skeleton_bone_list_changed() {
+	if (!is_dirty && !solver_rig->is_empty() && _get_skeleton_topology_hash() == skeleton_topology_hash) {
+		return;
+	}
+	_bone_list_changed();
 }
 
 int32_t ManyBoneIK3D::find_constraint(String p_string) const {
@@ -742,13 +1113,18 @@ void ManyBoneIK3D::remove_pin_at_index(int32_t p_index) {
 	ERR_FAIL_INDEX(p_index, constraint_count);
 
 	constraint_names.remove_at(p_index);
+	if (uint32_t(p_index) < constraint_kusudamas.size()) {
+		constraint_kusudamas.remove_at(p_index);
+	}
 	kusudama_open_cone_count.remove_at(p_index);
 	kusudama_open_cones.remove_at(p_index);
 	joint_twist.remove_at(p_index);
+	constraint_transforms.remove_at(p_index);
 
 	constraint_count--;
 
 	set_dirty();
+	_property_layout_changed();
 }
 
 void ManyBoneIK3D::_set_bone_count(int32_t p_count) {
@@ -758,7 +1134,7 @@ void ManyBoneIK3D::_set_bone_count(int32_t p_count) {
 	}
 	bone_count = p_count;
 	set_dirty();
-	notify_property_list_changed();
+	_property_layout_changed();
 }
 
 int32_t ManyBoneIK3D::get_bone_count() const {
@@ -769,141 +1145,126 @@ Vector<Ref<IKBone3D>> ManyBoneIK3D::get_bone_list() const {
 	return bone_list;
 }
 
+Ref<IKBone3D> ManyBoneIK3D::find_ik_bone(BoneId p_bone) const {
+	if (p_bone < 0 || p_bone >= int32_t(bone_list_indices.size()) || bone_list_indices[p_bone] == -1) {
+		return Ref<IKBone3D>();
+	}
+	return bone_list[bone_list_indices[p_bone]];
+}
+
+Ref<IKBone3D> ManyBoneIK3D::_find_constrained_ik_bone(int32_t p_index) const {
+	Skeleton3D *skeleton = get_skeleton();
+	if (!skeleton) {
+		return Ref<IKBone3D>();
+	}
+	Ref<IKBone3D> ik_bone = find_ik_bone(skeleton->find_bone(constraint_names[p_index]));
+	if (ik_bone.is_null() || ik_bone->get_constraint().is_null()) {
+		return Ref<IKBone3D>();
+	}
+	return ik_bone;
+}
+
+Variant ManyBoneIK3D::_get_saved_constraint_transform(int32_t p_index, bool p_is_set, const Transform3D &p_transform) const {
+	// Without a transform of its own or a rig to read the default from, null is saved so that loading keeps the default.
+	if (!p_is_set && _find_constrained_ik_bone(p_index).is_null()) {
+		return Variant();
+	}
+	return p_transform;
+}
+
+void ManyBoneIK3D::_apply_constraint_transforms(const ConstraintTransforms &p_transforms, const Ref<IKBone3D> &p_bone) {
+	if (p_transforms.has_bone_direction) {
+		p_bone->get_bone_direction_transform()->set_transform(p_transforms.bone_direction);
+	}
+	if (p_transforms.has_orientation) {
+		p_bone->get_constraint_orientation_transform()->set_transform(p_transforms.orientation);
+	}
+	if (p_transforms.has_twist) {
+		p_bone->get_constraint_twist_transform()->set_transform(p_transforms.twist);
+	}
+}
+
 void ManyBoneIK3D::set_direction_transform_of_bone(int32_t p_index, Transform3D p_transform) {
 	ERR_FAIL_INDEX(p_index, constraint_names.size());
-	if (!get_skeleton()) {
+	ConstraintTransforms &transforms = constraint_transforms[p_index];
+	transforms.bone_direction = p_transform;
+	transforms.has_bone_direction = true;
+	_release_state();
+	Ref<IKBone3D> ik_bone = _find_constrained_ik_bone(p_index);
+	if (ik_bone.is_null() || ik_bone->get_bone_direction_transform().is_null()) {
 		return;
 	}
-	String bone_name = constraint_names[p_index];
-	int32_t bone_index = get_skeleton()->find_bone(bone_name);
-	for (Ref<IKBoneSegment3D> segmented_skeleton : segmented_skeletons) {
-		if (segmented_skeleton.is_null()) {
-			continue;
-		}
-		Ref<IKBone3D> ik_bone = segmented_skeleton->get_ik_bone(bone_index);
-		if (ik_bone.is_null() || ik_bone->get_constraint().is_null()) {
-			continue;
-		}
-		if (ik_bone->get_bone_direction_transform().is_null()) {
-			continue;
-		}
-		ik_bone->get_bone_direction_transform()->set_transform(p_transform);
-		break;
-	}
+	ik_bone->get_bone_direction_transform()->set_transform(p_transform);
+	solver_rig->set_bone_direction(ik_bone->get_bone_id(), p_transform);
 }
 
 Transform3D ManyBoneIK3D::get_direction_transform_of_bone(int32_t p_index) const {
-	if (p_index < 0 || p_index >= constraint_names.size() || get_skeleton() == nullptr) {
+	if (p_index < 0 || p_index >= constraint_names.size()) {
 		return Transform3D();
 	}
-
-	String bone_name = constraint_names[p_index];
-	int32_t bone_index = get_skeleton()->find_bone(bone_name);
-	for (const Ref<IKBoneSegment3D> &segmented_skeleton : segmented_skeletons) {
-		if (segmented_skeleton.is_null()) {
-			continue;
-		}
-		Ref<IKBone3D> ik_bone = segmented_skeleton->get_ik_bone(bone_index);
-		if (ik_bone.is_null() || ik_bone->get_constraint().is_null()) {
-			continue;
-		}
-		return ik_bone->get_bone_direction_transform()->get_transform();
+	const ConstraintTransforms &transforms = constraint_transforms[p_index];
+	if (transforms.has_bone_direction) {
+		return transforms.bone_direction;
 	}
-	return Transform3D();
+	Ref<IKBone3D> ik_bone = _find_constrained_ik_bone(p_index);
+	if (ik_bone.is_null() || ik_bone->get_bone_direction_transform().is_null()) {
+		return Transform3D();
+	}
+	return ik_bone->get_bone_direction_transform()->get_transform();
 }
 
 Transform3D ManyBoneIK3D::get_orientation_transform_of_constraint(int32_t p_index) const {
 	ERR_FAIL_INDEX_V(p_index, constraint_names.size(), Transform3D());
-	String bone_name = constraint_names[p_index];
-	if (!segmented_skeletons.size()) {
-		return Transform3D();
+	const ConstraintTransforms &transforms = constraint_transforms[p_index];
+	if (transforms.has_orientation) {
+		return transforms.orientation;
 	}
-	if (!get_skeleton()) {
+	Ref<IKBone3D> ik_bone = _find_constrained_ik_bone(p_index);
+	if (ik_bone.is_null()) {
 		return Transform3D();
 	}
-	for (Ref<IKBoneSegment3D> segmented_skeleton : segmented_skeletons) {
-		if (segmented_skeleton.is_null()) {
-			continue;
-		}
-		Ref<IKBone3D> ik_bone = segmented_skeleton->get_ik_bone(get_skeleton()->find_bone(bone_name));
-		if (ik_bone.is_null()) {
-			continue;
-		}
-		if (ik_bone->get_constraint().is_null()) {
-			continue;
-		}
-		return ik_bone->get_constraint_orientation_transform()->get_transform();
-	}
-	return Transform3D();
+	return ik_bone->get_constraint_orientation_transform()->get_transform();
 }
 
 void ManyBoneIK3D::set_orientation_transform_of_constraint(int32_t p_index, Transform3D p_transform) {
 	ERR_FAIL_INDEX(p_index, constraint_names.size());
-	String bone_name = constraint_names[p_index];
-	if (!get_skeleton()) {
+	ConstraintTransforms &transforms = constraint_transforms[p_index];
+	transforms.orientation = p_transform;
+	transforms.has_orientation = true;
+	_release_state();
+	Ref<IKBone3D> ik_bone = _find_constrained_ik_bone(p_index);
+	if (ik_bone.is_null()) {
 		return;
 	}
-	for (Ref<IKBoneSegment3D> segmented_skeleton : segmented_skeletons) {
-		if (segmented_skeleton.is_null()) {
-			continue;
-		}
-		Ref<IKBone3D> ik_bone = segmented_skeleton->get_ik_bone(get_skeleton()->find_bone(bone_name));
-		if (ik_bone.is_null()) {
-			continue;
-		}
-		if (ik_bone->get_constraint().is_null()) {
-			continue;
-		}
-		ik_bone->get_constraint_orientation_transform()->set_transform(p_transform);
-		break;
-	}
+	ik_bone->get_constraint_orientation_transform()->set_transform(p_transform);
+	solver_rig->set_constraint_orientation(ik_bone->get_bone_id(), p_transform);
 }
 
 Transform3D ManyBoneIK3D::get_twist_transform_of_constraint(int32_t p_index) const {
 	ERR_FAIL_INDEX_V(p_index, constraint_names.size(), Transform3D());
-	String bone_name = constraint_names[p_index];
-	if (!segmented_skeletons.size()) {
-		return Transform3D();
+	const ConstraintTransforms &transforms = constraint_transforms[p_index];
+	if (transforms.has_twist) {
+		return transforms.twist;
 	}
-	if (!get_skeleton()) {
+	Ref<IKBone3D> ik_bone = _find_constrained_ik_bone(p_index);
+	if (ik_bone.is_null()) {
 		return Transform3D();
 	}
-	for (Ref<IKBoneSegment3D> segmented_skeleton : segmented_skeletons) {
-		if (segmented_skeleton.is_null()) {
-			continue;
-		}
-		Ref<IKBone3D> ik_bone = segmented_skeleton->get_ik_bone(get_skeleton()->find_bone(bone_name));
-		if (ik_bone.is_null()) {
-			continue;
-		}
-		if (ik_bone->get_constraint().is_null()) {
-			continue;
-		}
-		return ik_bone->get_constraint_twist_transform()->get_transform();
-	}
-	return Transform3D();
+	return ik_bone->get_constraint_twist_transform()->get_transform();
 }
 
 void ManyBoneIK3D::set_twist_transform_of_constraint(int32_t p_index, Transform3D p_transform) {
 	ERR_FAIL_INDEX(p_index, constraint_names.size());
-	String bone_name = constraint_names[p_index];
-	if (!get_skeleton()) {
+	ConstraintTransforms &transforms = constraint_transforms[p_index];
+	transforms.twist = p_transform;
+	transforms.has_twist = true;
+	_release_state();
+	Ref<IKBone3D> ik_bone = _find_constrained_ik_bone(p_index);
+	if (ik_bone.is_null()) {
 		return;
 	}
-	for (Ref<IKBoneSegment3D> segmented_skeleton : segmented_skeletons) {
-		if (segmented_skeleton.is_null()) {
-			continue;
-		}
-		Ref<IKBone3D> ik_bone = segmented_skeleton->get_ik_bone(get_skeleton()->find_bone(bone_name));
-		if (ik_bone.is_null()) {
-			continue;
-		}
-		if (ik_bone->get_constraint().is_null()) {
-			continue;
-		}
-		ik_bone->get_constraint_twist_transform()->set_transform(p_transform);
-		break;
-	}
+	ik_bone->get_constraint_twist_transform()->set_transform(p_transform);
+	solver_rig->set_constraint_twist(ik_bone->get_bone_id(), p_transform);
 }
 
 bool ManyBoneIK3D::get_pin_enabled(int32_t p_effector_index) const {
@@ -945,6 +1306,300 @@ void ManyBoneIK3D::set_constraint_mode(bool p_enabled) {
 	is_constraint_mode = p_enabled;
 }
 
+bool ManyBoneIK3D::get_multithreaded_solve() const {
+	return is_multithreaded_solve;
+}
+
+void ManyBoneIK3D::set_multithreaded_solve(bool p_enabled) {
+	is_multithreaded_solve = p_enabled;
+}
+
+bool ManyBoneIK3D::get_tolerance_mode() const {
+	return is_tolerance_mode;
+}
+
+void ManyBoneIK3D::set_tolerance_mode(bool p_enabled) {
+	is_tolerance_mode = p_enabled;
+}
+
+float ManyBoneIK3D::get_position_tolerance() const {
+	return position_tolerance;
+}
+
+void ManyBoneIK3D::set_position_tolerance(float p_tolerance) {
+	position_tolerance = MAX(p_tolerance, 0.0f);
+}
+
+float ManyBoneIK3D::get_orientation_tolerance() const {
+	return orientation_tolerance;
+}
+
+void ManyBoneIK3D::set_orientation_tolerance(float p_tolerance) {
+	orientation_tolerance = MAX(p_tolerance, 0.0f);
+}
+
+int32_t ManyBoneIK3D::get_last_iteration_count() const {
+	return last_iteration_count;
+}
+
+double ManyBoneIK3D::get_last_position_error() const {
+	return last_position_error;
+}
+
+double ManyBoneIK3D::get_last_orientation_error() const {
+	return last_orientation_error;
+}
+
+bool ManyBoneIK3D::get_warm_start() const {
+	return is_warm_start;
+}
+
+void ManyBoneIK3D::set_warm_start(bool p_enabled) {
+	is_warm_start = p_enabled;
+}
+
+float ManyBoneIK3D::get_warm_start_factor() const {
+	return warm_start_factor;
+}
+
+void ManyBoneIK3D::set_warm_start_factor(float p_factor) {
+	warm_start_factor = CLAMP(p_factor, 0.0f, 1.0f);
+}
+
+bool ManyBoneIK3D::get_sleep_mode() const {
+	return is_sleep_mode;
+}
+
+void ManyBoneIK3D::set_sleep_mode(bool p_enabled) {
+	is_sleep_mode = p_enabled;
+}
+
+float ManyBoneIK3D::get_sleep_epsilon() const {
+	return sleep_epsilon;
+}
+
+void ManyBoneIK3D::set_sleep_epsilon(float p_epsilon) {
+	sleep_epsilon = MAX(p_epsilon, 0.0f);
+}
+
+void ManyBoneIK3D::set_gizmo_update_rate(float p_rate) {
+	gizmo_update_rate = MAX(p_rate, 0.0f);
+}
+
+float ManyBoneIK3D::get_gizmo_update_rate() const {
+	return gizmo_update_rate;
+}
+
+void ManyBoneIK3D::set_packed_storage(bool p_enabled) {
+	is_packed_storage = p_enabled;
+	_property_layout_changed();
+}
+
+bool ManyBoneIK3D::get_packed_storage() const {
+	return is_packed_storage;
+}
+
+void ManyBoneIK3D::set_synchronous_rebuild(bool p_enabled) {
+	is_synchronous_rebuild = p_enabled;
+}
+
+bool ManyBoneIK3D::get_synchronous_rebuild() const {
+	return is_synchronous_rebuild;
+}
+
+bool ManyBoneIK3D::is_rebuilding_rig() const {
+	return rig_build_task != WorkerThreadPool::INVALID_TASK_ID;
+}
+
+Dictionary ManyBoneIK3D::_get_pin_data() const {
+	PackedStringArray bone_names;
+	Array target_nodes;
+	PackedFloat32Array parameters;
+	bone_names.resize(pins.size());
+	target_nodes.resize(pins.size());
+	parameters.resize(pins.size() * PIN_DATA_STRIDE);
+	float *parameter_data = parameters.ptrw();
+	for (int32_t pin_i = 0; pin_i < pins.size(); pin_i++) {
+		const Ref<IKEffectorTemplate3D> &effector_template = pins[pin_i];
+		if (effector_template.is_null()) {
+			continue;
+		}
+		bone_names.set(pin_i, effector_template->get_name());
+		target_nodes[pin_i] = effector_template->get_target_node();
+		float *parameter = parameter_data + pin_i * PIN_DATA_STRIDE;
+		Vector3 direction_priorities = effector_template->get_direction_priorities();
+		parameter[0] = effector_template->get_motion_propagation_factor();
+		parameter[1] = effector_template->get_weight();
+		parameter[2] = direction_priorities.x;
+		parameter[3] = direction_priorities.y;
+		parameter[4] = direction_priorities.z;
+	}
+	Dictionary data;
+	data["bone_names"] = bone_names;
+	data["target_nodes"] = target_nodes;
+	data["parameters"] = parameters;
+	return data;
+}
+
+void ManyBoneIK3D::_set_pin_data(const Dictionary &p_data) {
+	const PackedStringArray bone_names = p_data.get("bone_names", PackedStringArray());
+	const Array target_nodes = p_data.get("target_nodes", Array());
+	const PackedFloat32Array parameters = p_data.get("parameters", PackedFloat32Array());
+	ERR_FAIL_COND_MSG(target_nodes.size() != bone_names.size() || parameters.size() != bone_names.size() * PIN_DATA_STRIDE, "Pin data arrays do not match in size.");
+	for (int32_t pin_i = 0; pin_i < target_nodes.size(); pin_i++) {
+		ERR_FAIL_COND_MSG(target_nodes[pin_i].get_type() != Variant::NODE_PATH, "Pin data target nodes must be node paths.");
+	}
+	// Everything is validated first, so invalid data leaves the pins as they were.
+	// Written straight into the templates; going through the setters would mark the rig dirty once per field.
+	pin_count = bone_names.size();
+	pins.resize(pin_count);
+	const float *parameter_data = parameters.ptr();
+	for (int32_t pin_i = 0; pin_i < pin_count; pin_i++) {
+		Ref<IKEffectorTemplate3D> effector_template;
+		effector_template.instantiate();
+		const float *parameter = parameter_data + pin_i * PIN_DATA_STRIDE;
+		effector_template->set_name(bone_names[pin_i]);
+		effector_template->set_target_node(target_nodes[pin_i]);
+		effector_template->set_motion_propagation_factor(parameter[0]);
+		effector_template->set_weight(parameter[1]);
+		effector_template->set_direction_priorities(Vector3(parameter[2], parameter[3], parameter[4]));
+		pins.write[pin_i] = effector_template;
+	}
+	set_dirty();
+	_property_layout_changed();
+}
+
+Dictionary ManyBoneIK3D::_get_constraint_data() const {
+	PackedStringArray bone_names;
+	PackedVector2Array twists;
+	PackedInt32Array cone_counts;
+	PackedFloat32Array cones;
+	Array transforms;
+	bone_names.resize(constraint_count);
+	twists.resize(constraint_count);
+	cone_counts.resize(constraint_count);
+	transforms.resize(constraint_count * 3);
+	for (int32_t constraint_i = 0; constraint_i < constraint_count; constraint_i++) {
+		bone_names.set(constraint_i, constraint_names[constraint_i]);
+		twists.set(constraint_i, joint_twist[constraint_i]);
+		int32_t cone_count = MIN(kusudama_open_cone_count[constraint_i], kusudama_open_cones[constraint_i].size());
+		cone_counts.set(constraint_i, cone_count);
+		for (int32_t cone_i = 0; cone_i < cone_count; cone_i++) {
+			const Vector4 &cone = kusudama_open_cones[constraint_i][cone_i];
+			cones.push_back(cone.x);
+			cones.push_back(cone.y);
+			cones.push_back(cone.z);
+			cones.push_back(cone.w);
+		}
+		const ConstraintTransforms &constraint_transform = constraint_transforms[constraint_i];
+		transforms[constraint_i * 3] = _get_saved_constraint_transform(constraint_i, constraint_transform.has_bone_direction, get_direction_transform_of_bone(constraint_i));
+		transforms[constraint_i * 3 + 1] = _get_saved_constraint_transform(constraint_i, constraint_transform.has_orientation, get_orientation_transform_of_constraint(constraint_i));
+		transforms[constraint_i * 3 + 2] = _get_saved_constraint_transform(constraint_i, constraint_transform.has_twist, get_twist_transform_of_constraint(constraint_i));
+	}
+	Dictionary data;
+	data["bone_names"] = bone_names;
+	data["twists"] = twists;
+	data["cone_counts"] = cone_counts;
+	data["cones"] = cones;
+	data["transforms"] = transforms;
+	return data;
+}
+
+void ManyBoneIK3D::_set_constraint_data(const Dictionary &p_data) {
+	const PackedStringArray bone_names = p_data.get("bone_names", PackedStringArray());
+	const PackedVector2Array twists = p_data.get("twists", PackedVector2Array());
+	const PackedInt32Array cone_counts = p_data.get("cone_counts", PackedInt32Array());
+	const PackedFloat32Array cones = p_data.get("cones", PackedFloat32Array());
+	const Array transforms = p_data.get("transforms", Array());
+	const int32_t count = bone_names.size();
+	ERR_FAIL_COND_MSG(twists.size() != count || cone_counts.size() != count, "Constraint data arrays do not match in size.");
+	int32_t total_cone_count = 0;
+	for (int32_t cone_count : cone_counts) {
+		ERR_FAIL_COND_MSG(cone_count < 0, "Constraint data has a negative cone count.");
+		total_cone_count += cone_count;
+	}
+	ERR_FAIL_COND_MSG(cones.size() != total_cone_count * CONE_DATA_STRIDE, "Constraint data cone count does not match its cones.");
+	// Null entries were saved without a value and keep the rig's defaults.
+	ERR_FAIL_COND_MSG(!transforms.is_empty() && transforms.size() != count * 3, "Constraint data transforms do not match its constraints.");
+	for (int32_t transform_i = 0; transform_i < transforms.size(); transform_i++) {
+		const Variant::Type type = transforms[transform_i].get_type();
+		ERR_FAIL_COND_MSG(type != Variant::NIL && type != Variant::TRANSFORM3D, "Constraint data transforms must be Transform3D or null.");
+	}
+
+	constraint_count = count;
+	constraint_names.resize(count);
+	joint_twist.resize(count);
+	kusudama_open_cone_count.resize(count);
+	kusudama_open_cones.resize(count);
+	constraint_transforms.resize(count);
+	const float *cone_data = cones.ptr();
+	for (int32_t constraint_i = 0; constraint_i < count; constraint_i++) {
+		constraint_names.write[constraint_i] = bone_names[constraint_i];
+		joint_twist.write[constraint_i] = twists[constraint_i];
+		int32_t cone_count = cone_counts[constraint_i];
+		kusudama_open_cone_count.write[constraint_i] = cone_count;
+		Vector<Vector4> &constraint_cones = kusudama_open_cones.write[constraint_i];
+		constraint_cones.resize(MAX(cone_count, 1));
+		// A constraint without cones keeps the same placeholder _set_constraint_count gives it.
+		constraint_cones.write[0] = Vector4(0, 1, 0, 0.01745f);
+		for (int32_t cone_i = 0; cone_i < cone_count; cone_i++) {
+			constraint_cones.write[cone_i] = Vector4(cone_data[0], cone_data[1], cone_data[2], cone_data[3]);
+			cone_data += CONE_DATA_STRIDE;
+		}
+		ConstraintTransforms &constraint_transform = constraint_transforms[constraint_i];
+		constraint_transform = ConstraintTransforms();
+		if (transforms.is_empty()) {
+			continue;
+		}
+		const Variant &bone_direction = transforms[constraint_i * 3];
+		const Variant &orientation = transforms[constraint_i * 3 + 1];
+		const Variant &twist = transforms[constraint_i * 3 + 2];
+		constraint_transform.has_bone_direction = bone_direction.get_type() == Variant::TRANSFORM3D;
+		constraint_transform.has_orientation = orientation.get_type() == Variant::TRANSFORM3D;
+		constraint_transform.has_twist = twist.get_type() == Variant::TRANSFORM3D;
+		if (constraint_transform.has_bone_direction) {
+			constraint_transform.bone_direction = bone_direction;
+		}
+		if (constraint_transform.has_orientation) {
+			constraint_transform.orientation = orientation;
+		}
+		if (constraint_transform.has_twist) {
+			constraint_transform.twist = twist;
+		}
+	}
+	// The transforms are applied to the rig when it is rebuilt.
+	set_dirty();
+	_property_layout_changed();
+}
+
+int64_t ManyBoneIK3D::get_skipped_frame_count() const {
+	return skipped_frame_count;
+}
+
+int64_t ManyBoneIK3D::get_rig_memory_high_water_mark() const {
+	// Both rigs keep their storage, since the spare one is refilled by the next rebuild.
+	return solver_rigs[0].get_memory_high_water_mark() + solver_rigs[1].get_memory_high_water_mark();
+}
+
+bool ManyBoneIK3D::get_batched_solve() const {
+	return is_batched_solve;
+}
+
+void ManyBoneIK3D::set_batched_solve(bool p_enabled) {
+	if (is_batched_solve == p_enabled) {
+		return;
+	}
+	is_batched_solve = p_enabled;
+	if (!is_inside_tree() || !ManyBoneIK3DServer::get_singleton()) {
+		return;
+	}
+	if (is_batched_solve) {
+		ManyBoneIK3DServer::get_singleton()->register_instance(this);
+	} else {
+		ManyBoneIK3DServer::get_singleton()->unregister_instance(this);
+	}
+}
+
 int32_t ManyBoneIK3D::get_ui_selected_bone() const {
 	return ui_selected_bone;
 }
@@ -991,73 +1646,257 @@ int32_t ManyBoneIK3D::find_pin(String p_string) const {
 }
 
 void ManyBoneIK3D::_bone_list_changed() {
-	Skeleton3D *skeleton = get_skeleton();
-	Vector<int32_t> roots = skeleton->get_parentless_bones();
-	if (roots.is_empty()) {
+	_cancel_rig_build();
+	if (_apply_state()) {
 		return;
 	}
-	bone_list.clear();
-	segmented_skeletons.clear();
-	for (BoneId root_bone_index : roots) {
-		String parentless_bone = skeleton->get_bone_name(root_bone_index);
-		Ref<IKBoneSegment3D> segmented_skeleton = Ref<IKBoneSegment3D>(memnew(IKBoneSegment3D(skeleton, parentless_bone, pins, this, nullptr, root_bone_index, -1, stabilize_passes)));
-		ik_origin.instantiate();
-		segmented_skeleton->get_root()->get_ik_transform()->set_parent(ik_origin);
-		segmented_skeleton->generate_default_segments(pins, root_bone_index, -1, this);
+	if (!_prepare_rig_build(false)) {
+		return;
+	}
+	_build_rig(&rig_build);
+	_apply_rig_build();
+}
+
+bool ManyBoneIK3D::_prepare_rig_build(bool p_background) {
+	Skeleton3D *skeleton = get_skeleton();
+	ERR_FAIL_NULL_V(skeleton, false);
+	RigBuild &build = rig_build;
+	build.skeleton_snapshot.capture(skeleton);
+	if (build.skeleton_snapshot.parentless_bones.is_empty()) {
+		build.skeleton_snapshot.clear();
+		return false;
+	}
+	build.skeleton = skeleton;
+	build.skeleton_snapshot.default_damp = get_default_damp();
+	build.skeleton_snapshot.iterations_per_frame = get_iterations_per_frame();
+	// The worker reads copies of the pins, so edits made while it runs cannot race with it.
+	build.pins.resize(pins.size());
+	for (int32_t pin_i = 0; pin_i < pins.size(); pin_i++) {
+		const Ref<IKEffectorTemplate3D> &pin = pins[pin_i];
+		if (pin.is_null()) {
+			continue;
+		}
+		Ref<IKEffectorTemplate3D> pin_copy;
+		pin_copy.instantiate();
+		pin_copy->set_name(pin->get_name());
+		pin_copy->set_root_bone(pin->get_root_bone());
+		pin_copy->set_target_node(pin->get_target_node());
+		pin_copy->set_motion_propagation_factor(pin->get_motion_propagation_factor());
+		pin_copy->set_weight(pin->get_weight());
+		pin_copy->set_direction_priorities(pin->get_direction_priorities());
+		build.pins.write[pin_i] = pin_copy;
+	}
+	build.bone_damp = bone_damp;
+	build.default_damp = get_default_damp();
+	build.skeleton_topology_hash = _get_skeleton_topology_hash();
+	build.stabilize_passes = stabilize_passes;
+	build.constraint_names = constraint_names;
+	build.kusudama_open_cone_count = kusudama_open_cone_count;
+	build.kusudama_open_cones = kusudama_open_cones;
+	build.joint_twist = joint_twist;
+	build.constraint_transforms = constraint_transforms;
+	// The rig being solved still points at the cached kusudamas, so a background build configures its own.
+	if (p_background) {
+		build.constraint_kusudamas.clear();
+	} else {
+		build.constraint_kusudamas = constraint_kusudamas;
+	}
+	build.constraint_kusudamas.resize(constraint_count);
+	dirty_pins.clear();
+	dirty_constraints.clear();
+	return true;
+}
+
+void ManyBoneIK3D::_build_rig(RigBuild *p_build) {
+	// Runs on a worker for background rebuilds, and only reads what _prepare_rig_build() copied into the build.
+	const IKSkeletonSnapshot3D &snapshot = p_build->skeleton_snapshot;
+	for (BoneId root_bone_index : snapshot.parentless_bones) {
+		String parentless_bone = snapshot.get_bone_name(root_bone_index);
+		Ref<IKBoneSegment3D> segmented_skeleton = Ref<IKBoneSegment3D>(memnew(IKBoneSegment3D(&snapshot, parentless_bone, p_build->pins, nullptr, root_bone_index, -1, p_build->stabilize_passes)));
+		p_build->ik_origin.instantiate();
+		segmented_skeleton->get_root()->get_ik_transform()->set_parent(p_build->ik_origin);
+		segmented_skeleton->generate_default_segments(p_build->pins, root_bone_index, -1);
 		Vector<Ref<IKBone3D>> new_bone_list;
 		segmented_skeleton->create_bone_list(new_bone_list, true);
-		bone_list.append_array(new_bone_list);
+		p_build->bone_list.append_array(new_bone_list);
 		Vector<Vector<double>> weight_array;
 		segmented_skeleton->update_pinned_list(weight_array);
 		segmented_skeleton->recursive_create_headings_arrays_for(segmented_skeleton);
-		segmented_skeletons.push_back(segmented_skeleton);
-	}
-	_update_ik_bones_transform();
-	for (Ref<IKBone3D> &ik_bone_3d : bone_list) {
-		ik_bone_3d->update_default_bone_direction_transform(skeleton);
-	}
-	for (int constraint_i = 0; constraint_i < constraint_count; ++constraint_i) {
-		String bone = constraint_names[constraint_i];
-		BoneId bone_id = skeleton->find_bone(bone);
-		for (Ref<IKBone3D> &ik_bone_3d : bone_list) {
-			if (ik_bone_3d->get_bone_id() != bone_id) {
-				continue;
-			}
-			Ref<IKKusudama3D> constraint;
-			constraint.instantiate();
-			constraint->enable_orientational_limits();
-
-			int32_t cone_count = kusudama_open_cone_count[constraint_i];
-			const Vector<Vector4> &cones = kusudama_open_cones[constraint_i];
-			for (int32_t cone_i = 0; cone_i < cone_count; ++cone_i) {
-				const Vector4 &cone = cones[cone_i];
-				Ref<IKLimitCone3D> new_cone;
-				new_cone.instantiate();
-				new_cone->set_attached_to(constraint);
-				new_cone->set_radius(MAX(1.0e-38, cone.w));
-				new_cone->set_control_point(Vector3(cone.x, cone.y, cone.z).normalized());
-				constraint->add_open_cone(new_cone);
-			}
+		p_build->segmented_skeletons.push_back(segmented_skeleton);
+	}
+	p_build->pin_bones.resize(p_build->pins.size());
+	for (int32_t pin_i = 0; pin_i < p_build->pins.size(); pin_i++) {
+		const Ref<IKEffectorTemplate3D> &pin = p_build->pins[pin_i];
+		p_build->pin_bones[pin_i] = pin.is_valid() ? snapshot.find_bone(pin->get_name()) : -1;
+	}
+	const int32_t skeleton_bone_count = snapshot.get_bone_count();
+	p_build->bone_list_indices.resize(skeleton_bone_count);
+	for (int32_t &bone_index : p_build->bone_list_indices) {
+		bone_index = -1;
+	}
+	for (int32_t bone_i = 0; bone_i < p_build->bone_list.size(); bone_i++) {
+		BoneId bone_id = p_build->bone_list[bone_i]->get_bone_id();
+		if (bone_id >= 0 && bone_id < skeleton_bone_count) {
+			p_build->bone_list_indices[bone_id] = bone_i;
+		}
+	}
+	for (int32_t bone_i = p_build->bone_list.size(); bone_i-- > 0;) {
+		const Ref<IKBone3D> &bone = p_build->bone_list[bone_i];
+		BoneId bone_id = bone->get_bone_id();
+		if (bone_id >= 0 && bone_id < skeleton_bone_count) {
+			bone->set_pose(snapshot.bone_poses[bone_id]);
+		}
+	}
+	for (const Ref<IKBone3D> &ik_bone_3d : p_build->bone_list) {
+		ik_bone_3d->update_default_bone_direction_transform(&snapshot);
+	}
+	const int32_t build_constraint_count = MIN(p_build->constraint_names.size(), int32_t(p_build->constraint_kusudamas.size()));
+	for (int32_t constraint_i = 0; constraint_i < build_constraint_count; ++constraint_i) {
+		BoneId bone_id = snapshot.find_bone(p_build->constraint_names[constraint_i]);
+		if (bone_id < 0 || bone_id >= skeleton_bone_count || p_build->bone_list_indices[bone_id] == -1) {
+			continue;
+		}
+		const Vector2 axial_limit = constraint_i < p_build->joint_twist.size() ? p_build->joint_twist[constraint_i] : Vector2();
+		const Ref<IKBone3D> &ik_bone = p_build->bone_list[p_build->bone_list_indices[bone_id]];
+		_configure_constraint(p_build->constraint_kusudamas[constraint_i], p_build->kusudama_open_cone_count[constraint_i], p_build->kusudama_open_cones[constraint_i], axial_limit, ik_bone);
+		_apply_constraint_transforms(p_build->constraint_transforms[constraint_i], ik_bone);
+	}
+	p_build->solver_rig->build(p_build->segmented_skeletons, p_build->bone_damp, p_build->default_damp);
+	p_build->pin_effectors.resize(p_build->pin_bones.size());
+	for (uint32_t pin_i = 0; pin_i < p_build->pin_bones.size(); pin_i++) {
+		p_build->pin_effectors[pin_i] = p_build->solver_rig->find_effector(p_build->pin_bones[pin_i]);
+	}
+}
 
-			const Vector2 axial_limit = get_joint_twist(constraint_i);
-			constraint->enable_axial_limits();
-			constraint->set_axial_limits(axial_limit.x, axial_limit.y);
-			ik_bone_3d->add_constraint(constraint);
-			constraint->_update_constraint(ik_bone_3d->get_constraint_twist_transform());
-			break;
+bool ManyBoneIK3D::_is_rig_build_completed() const {
+	return rig_build_task != WorkerThreadPool::INVALID_TASK_ID && WorkerThreadPool::get_singleton()->is_task_completed(rig_build_task);
+}
+
+void ManyBoneIK3D::_apply_rig_build() {
+	if (rig_build_task != WorkerThreadPool::INVALID_TASK_ID) {
+		WorkerThreadPool::get_singleton()->wait_for_task_completion(rig_build_task);
+		rig_build_task = WorkerThreadPool::INVALID_TASK_ID;
+	}
+	RigBuild &build = rig_build;
+	Skeleton3D *skeleton = build.skeleton;
+	segmented_skeletons = build.segmented_skeletons;
+	bone_list = build.bone_list;
+	bone_list_indices = build.bone_list_indices;
+	pin_effectors = build.pin_effectors;
+	constraint_kusudamas = build.constraint_kusudamas;
+	ik_origin = build.ik_origin;
+	skeleton_topology_hash = build.skeleton_topology_hash;
+	// The replaced rig becomes the spare, and the next rebuild reuses its storage.
+	SWAP(solver_rig, build.solver_rig);
+	_clear_rig_build();
+	// Target paths set while the build ran are not in the graph it was built from.
+	for (uint32_t pin_i = 0; pin_i < pin_effectors.size(); pin_i++) {
+		if (pin_effectors[pin_i] != -1 && int32_t(pin_i) < pins.size() && pins[pin_i].is_valid()) {
+			solver_rig->set_effector_target_node(pin_effectors[pin_i], skeleton, pins[pin_i]->get_target_node());
 		}
 	}
+	is_rig_from_state = false;
+	_clear_batched_result();
+	solver_rig->read_effector_targets(skeleton->get_global_transform().affine_inverse(), this);
+	emit_signal(SNAME("rig_rebuilt"));
+}
+
+void ManyBoneIK3D::_cancel_rig_build() {
+	if (rig_build_task == WorkerThreadPool::INVALID_TASK_ID) {
+		return;
+	}
+	WorkerThreadPool::get_singleton()->wait_for_task_completion(rig_build_task);
+	rig_build_task = WorkerThreadPool::INVALID_TASK_ID;
+	_clear_rig_build();
+}
+
+void ManyBoneIK3D::_clear_rig_build() {
+	RigBuild &build = rig_build;
+	build.skeleton = nullptr;
+	build.skeleton_snapshot.clear();
+	build.pins.clear();
+	build.bone_damp.clear();
+	build.constraint_names.clear();
+	build.kusudama_open_cone_count.clear();
+	build.kusudama_open_cones.clear();
+	build.joint_twist.clear();
+	build.constraint_transforms.clear();
+	build.segmented_skeletons.clear();
+	build.bone_list.clear();
+	build.bone_list_indices.clear();
+	build.pin_bones.clear();
+	build.pin_effectors.clear();
+	build.constraint_kusudamas.clear();
+	build.ik_origin.unref();
+	build.solver_rig->clear();
+}
+
+bool ManyBoneIK3D::_apply_state() {
+	// The state is a runtime shortcut; the editor always compiles the settings so that edits show up.
+	if (state.is_null() || state->is_empty() || is_state_outdated || Engine::get_singleton()->is_editor_hint()) {
+		return false;
+	}
+	Skeleton3D *skeleton = get_skeleton();
+	uint32_t topology_hash = _get_skeleton_topology_hash();
+	if (uint32_t(state->get_skeleton_topology_hash()) != topology_hash) {
+		WARN_PRINT_ONCE("ManyBoneIK3DState was baked for a different skeleton, compiling the rig from the node settings instead.");
+		return false;
+	}
+	bone_list.clear();
+	bone_list_indices.clear();
+	segmented_skeletons.clear();
+	pin_effectors.clear();
+	dirty_pins.clear();
+	dirty_constraints.clear();
+	_clear_batched_result();
+	if (!solver_rig->build_from_state(state.ptr(), skeleton)) {
+		return false;
+	}
+	solver_rig->read_effector_targets(skeleton->get_global_transform().affine_inverse(), this);
+	skeleton_topology_hash = topology_hash;
+	is_rig_from_state = true;
+	is_dirty = false;
+	return true;
+}
+
+void ManyBoneIK3D::_release_state() {
+	// Compiles the graph in place of a rig applied from the state, so that an edit has bones to apply to.
+	if (!is_rig_from_state || !get_skeleton()) {
+		return;
+	}
+	is_state_outdated = true;
+	is_dirty = false;
+	_bone_list_changed();
+}
+
+void ManyBoneIK3D::set_state(Ref<ManyBoneIK3DState> p_state) {
+	state = p_state;
+	is_state_outdated = false;
+	is_dirty = true;
+}
+
+Ref<ManyBoneIK3DState> ManyBoneIK3D::get_state() const {
+	return state;
+}
+
+Ref<ManyBoneIK3DState> ManyBoneIK3D::bake_state() const {
+	Ref<ManyBoneIK3DState> baked_state;
+	ERR_FAIL_COND_V_MSG(solver_rig->is_empty(), baked_state, "The rig has not been compiled yet.");
+	baked_state.instantiate();
+	solver_rig->bake_state(baked_state.ptr());
+	baked_state->set_skeleton_topology_hash(skeleton_topology_hash);
+	return baked_state;
 }
 
 void ManyBoneIK3D::_skeleton_changed(Skeleton3D *p_old, Skeleton3D *p_new) {
 	if (p_old) {
-		if (p_old->is_connected(SNAME("bone_list_changed"), callable_mp(this, &ManyBoneIK3D::_bone_list_changed))) {
-			p_old->disconnect(SNAME("bone_list_changed"), callable_mp(this, &ManyBoneIK3D::_bone_list_changed));
+		if (p_old->is_connected(SNAME("bone_list_changed"), callable_mp(this, &ManyBoneIK3D::_on_skeleton_bone_list_changed))) {
+			p_old->disconnect(SNAME("bone_list_changed"), callable_mp(this, &ManyBoneIK3D::_on_skeleton_bone_list_changed));
 		}
 	}
 	if (p_new) {
-		if (!p_new->is_connected(SNAME("bone_list_changed"), callable_mp(this, &ManyBoneIK3D::_bone_list_changed))) {
-			p_new->connect(SNAME("bone_list_changed"), callable_mp(this, &ManyBoneIK3D::_bone_list_changed));
+		if (!p_new->is_connected(SNAME("bone_list_changed"), callable_mp(this, &ManyBoneIK3D::_on_skeleton_bone_list_changed))) {
+			p_new->connect(SNAME("bone_list_changed"), callable_mp(this, &ManyBoneIK3D::_on_skeleton_bone_list_changed));
 		}
 	}
 	if (is_connected(SNAME("modification_processed"), callable_mp(this, &ManyBoneIK3D::_update_ik_bones_transform))) {
@@ -1076,4 +1915,6 @@ void ManyBoneIK3D::set_pin_bone_name(int32_t p_pin_index, const String &p_bone)
 	}
 	effector_template->set_name(p_bone);
 	set_dirty();
+	// The bone name hints leave out pinned bones.
+	_property_layout_changed();
 }
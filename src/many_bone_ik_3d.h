@@ -34,23 +34,58 @@
 #include "core/math/transform_3d.h"
 #include "core/math/vector3.h"
 #include "core/object/ref_counted.h"
+#include "core/object/worker_thread_pool.h"
 #include "ik_bone_3d.h"
 #include "ik_effector_template_3d.h"
+#include "ik_solver_rig_3d.h"
+#include "many_bone_ik_3d_state.h"
 #include "math/ik_node_3d.h"
 #include "scene/3d/skeleton_3d.h"
 #include "scene/3d/skeleton_modifier_3d.h"
 
-class ManyBoneIK3DState;
 class ManyBoneIK3D : public SkeletonModifier3D {
 	GDCLASS(ManyBoneIK3D, SkeletonModifier3D);
+	friend class ManyBoneIK3DServer;
 
 	bool is_constraint_mode = false;
+	bool is_multithreaded_solve = false;
+	bool is_batched_solve = false;
+	// Frames of the tick the server solved this node in. A result stamped with any other tick is stale.
+	uint64_t batched_result_process_frame = UINT64_MAX;
+	uint64_t batched_result_physics_frame = UINT64_MAX;
+	bool is_tolerance_mode = false;
+	float position_tolerance = 0.001f;
+	float orientation_tolerance = Math::deg_to_rad(0.5f);
+	int32_t last_iteration_count = 0;
+	double last_position_error = 0.0;
+	double last_orientation_error = 0.0;
+	bool is_warm_start = false;
+	float warm_start_factor = 0.8f;
+	bool is_sleep_mode = false;
+	float sleep_epsilon = 1e-5f;
+	uint64_t skipped_frame_count = 0;
+	uint64_t last_solve_process_frame = UINT64_MAX;
+	uint64_t last_solve_physics_frame = UINT64_MAX;
+	// The inspector property list is rebuilt only when the skeleton's bones or the pin and constraint layout change.
+	uint32_t property_layout_version = 0;
+	mutable LocalVector<PropertyInfo> property_list_cache;
+	mutable uint32_t property_list_cache_layout_version = UINT32_MAX;
+	mutable ObjectID property_list_cache_skeleton;
+	mutable uint64_t property_list_cache_skeleton_version = 0;
+	float gizmo_update_rate = 15.0f; // Redraws per second of the edited node's gizmo while it solves; 0 redraws every solve.
+	uint64_t last_gizmo_update_usec = 0;
+	bool is_gizmo_redraw_enabled = false; // Set by the editor plugin while this node is being edited.
+	bool is_packed_storage = false; // Saves pins and constraints as two packed dictionaries instead of one property per field.
 	NodePath skeleton_path;
 	Vector<Ref<IKBoneSegment3D>> segmented_skeletons;
 	int32_t constraint_count = 0, pin_count = 0, bone_count = 0;
 	Vector<StringName> constraint_names;
 	Vector<Ref<IKEffectorTemplate3D>> pins;
 	Vector<Ref<IKBone3D>> bone_list;
+	LocalVector<int32_t> bone_list_indices; // Per skeleton bone, its index in bone_list or -1.
+	// The rig being solved and a spare one that a rebuild fills; they swap when it completes, so both keep their storage.
+	IKSolverRig3D solver_rigs[2];
+	IKSolverRig3D *solver_rig = &solver_rigs[0];
 	Vector<Vector2> joint_twist;
 	Vector<float> bone_damp;
 	Vector<Vector<Vector4>> kusudama_open_cones;
@@ -61,13 +96,71 @@ class ManyBoneIK3D : public SkeletonModifier3D {
 	Ref<IKNode3D> godot_skeleton_transform;
 	Transform3D godot_skeleton_transform_inverse;
 	Ref<IKNode3D> ik_origin;
-	bool is_dirty = true;
+	bool is_dirty = true; // Topology: segments, bones and constraints are rebuilt.
+	LocalVector<int32_t> dirty_pins; // Pin indices whose weights and priorities are patched into the rig on their own.
+	LocalVector<int32_t> pin_effectors; // Per pin index, its effector in the solver rig or -1. Mapped once per build.
+	LocalVector<int32_t> dirty_constraints; // Constraint indices whose kusudama is rebuilt on its own.
+	// Per constraint index. Kept across rebuilds and reconfigured in place, so a rebuild only allocates kusudamas and cones it has never had.
+	LocalVector<Ref<IKKusudama3D>> constraint_kusudamas;
+	// Per constraint index, the transforms set through the setters or loaded from a scene. They replace the
+	// rig's defaults after every rebuild, so they can be saved and loaded while there is no rig.
+	struct ConstraintTransforms {
+		Transform3D bone_direction;
+		Transform3D orientation;
+		Transform3D twist;
+		bool has_bone_direction = false;
+		bool has_orientation = false;
+		bool has_twist = false;
+	};
+	LocalVector<ConstraintTransforms> constraint_transforms;
+	uint32_t skeleton_topology_hash = 0;
+	Ref<ManyBoneIK3DState> state;
+	bool is_rig_from_state = false; // The rig was applied from state and has no IKBone3D graph behind it.
+	bool is_state_outdated = false; // Settings changed after the state was applied, so rebuilds compile them instead.
 	NodePath skeleton_node_path = NodePath("..");
 	int32_t ui_selected_bone = -1, stabilize_passes = 0;
 
+	// The skeleton, pin and constraint data are copied on the main thread, and the worker generates and
+	// compiles the bone graph from those copies only, so it never reads the node or the skeleton.
+	struct RigBuild {
+		Skeleton3D *skeleton = nullptr; // Only dereferenced by the swap on the main thread.
+		IKSkeletonSnapshot3D skeleton_snapshot;
+		Vector<Ref<IKEffectorTemplate3D>> pins;
+		Vector<float> bone_damp;
+		float default_damp = 0.0f;
+		uint32_t skeleton_topology_hash = 0;
+		int32_t stabilize_passes = 0;
+		Vector<StringName> constraint_names;
+		Vector<int> kusudama_open_cone_count;
+		Vector<Vector<Vector4>> kusudama_open_cones;
+		Vector<Vector2> joint_twist;
+		LocalVector<ConstraintTransforms> constraint_transforms;
+
+		Vector<Ref<IKBoneSegment3D>> segmented_skeletons;
+		Vector<Ref<IKBone3D>> bone_list;
+		LocalVector<int32_t> bone_list_indices;
+		LocalVector<BoneId> pin_bones;
+		LocalVector<int32_t> pin_effectors;
+		LocalVector<Ref<IKKusudama3D>> constraint_kusudamas;
+		Ref<IKNode3D> ik_origin;
+		IKSolverRig3D *solver_rig = nullptr;
+	};
+	RigBuild rig_build;
+	WorkerThreadPool::TaskID rig_build_task = WorkerThreadPool::INVALID_TASK_ID;
+	bool is_synchronous_rebuild = false; // Rebuilds block the frame instead of running on a worker.
+
 	void _on_timer_timeout();
 	void _update_ik_bones_transform();
 	void _update_skeleton_bones_transform();
+	void _update_gizmos_if_due();
+	void _solve(bool p_multithreaded);
+	bool _begin_batched_solve();
+	bool _has_batched_result() const;
+	void _clear_batched_result();
+	bool _is_first_enabled_modifier() const;
+	void _read_skeleton_poses();
+	void _invalidate_pin_target_nodes();
+	bool _is_asleep() const;
 	Vector<Ref<IKEffectorTemplate3D>> _get_bone_effectors() const;
 	void set_constraint_name_at_index(int32_t p_index, String p_name);
 	void _set_constraint_count(int32_t p_count);
@@ -76,6 +169,33 @@ class ManyBoneIK3D : public SkeletonModifier3D {
 	void _set_pin_root_bone(int32_t p_pin_index, const String &p_root_bone);
 	String _get_pin_root_bone(int32_t p_pin_index) const;
 	void _bone_list_changed();
+	bool _prepare_rig_build(bool p_background);
+	void _build_rig(RigBuild *p_build);
+	void _apply_rig_build();
+	void _cancel_rig_build();
+	void _clear_rig_build();
+	bool _is_rig_build_completed() const;
+	bool _apply_state();
+	void _release_state();
+	void _on_skeleton_bone_list_changed();
+	uint32_t _get_skeleton_topology_hash() const;
+	void _set_weights_dirty(int32_t p_pin_index);
+	void _update_pin_target_node(int32_t p_pin_index);
+	void _set_constraint_dirty(int32_t p_constraint_index);
+	void _update_dirty_parameters();
+	bool _update_pin_weights();
+	void _update_dirty_constraints();
+	Ref<IKKusudama3D> _create_constraint(int32_t p_constraint_index, const Ref<IKBone3D> &p_bone);
+	static void _configure_constraint(Ref<IKKusudama3D> &r_constraint, int32_t p_cone_count, const Vector<Vector4> &p_cones, const Vector2 &p_axial_limit, const Ref<IKBone3D> &p_bone);
+	static void _apply_constraint_transforms(const ConstraintTransforms &p_transforms, const Ref<IKBone3D> &p_bone);
+	Ref<IKBone3D> _find_constrained_ik_bone(int32_t p_index) const;
+	Variant _get_saved_constraint_transform(int32_t p_index, bool p_is_set, const Transform3D &p_transform) const;
+	void _property_layout_changed();
+	void _update_property_list_cache() const;
+	Dictionary _get_pin_data() const;
+	void _set_pin_data(const Dictionary &p_data);
+	Dictionary _get_constraint_data() const;
+	void _set_constraint_data(const Dictionary &p_data);
 	void _pose_updated();
 	void _update_ik_bone_pose(int32_t p_bone_idx);
 
@@ -84,12 +204,14 @@ protected:
 	bool _get(const StringName &p_name, Variant &r_ret) const;
 	void _get_property_list(List<PropertyInfo> *p_list) const;
 	static void _bind_methods();
+	void _notification(int p_what);
 	virtual void _process_modification(double p_delta) override;
 	void _skeleton_changed(Skeleton3D *p_old, Skeleton3D *p_new) override;
 
 public:
 	void set_state(Ref<ManyBoneIK3DState> p_state);
 	Ref<ManyBoneIK3DState> get_state() const;
+	Ref<ManyBoneIK3DState> bake_state() const;
 	void add_constraint();
 	void set_stabilization_passes(int32_t p_passes);
 	int32_t get_stabilization_passes();
@@ -99,10 +221,42 @@ public:
 	int32_t get_ui_selected_bone() const;
 	void set_constraint_mode(bool p_enabled);
 	bool get_constraint_mode() const;
+	void set_multithreaded_solve(bool p_enabled);
+	bool get_multithreaded_solve() const;
+	void set_batched_solve(bool p_enabled);
+	bool get_batched_solve() const;
+	void set_tolerance_mode(bool p_enabled);
+	bool get_tolerance_mode() const;
+	void set_position_tolerance(float p_tolerance);
+	float get_position_tolerance() const;
+	void set_orientation_tolerance(float p_tolerance);
+	float get_orientation_tolerance() const;
+	int32_t get_last_iteration_count() const;
+	double get_last_position_error() const;
+	double get_last_orientation_error() const;
+	void set_warm_start(bool p_enabled);
+	bool get_warm_start() const;
+	void set_warm_start_factor(float p_factor);
+	float get_warm_start_factor() const;
+	void set_sleep_mode(bool p_enabled);
+	bool get_sleep_mode() const;
+	void set_sleep_epsilon(float p_epsilon);
+	float get_sleep_epsilon() const;
+	int64_t get_skipped_frame_count() const;
+	int64_t get_rig_memory_high_water_mark() const;
+	void set_gizmo_update_rate(float p_rate);
+	float get_gizmo_update_rate() const;
+	void set_gizmo_redraw_enabled(bool p_enabled);
+	void set_packed_storage(bool p_enabled);
+	bool get_packed_storage() const;
+	void set_synchronous_rebuild(bool p_enabled);
+	bool get_synchronous_rebuild() const;
+	bool is_rebuilding_rig() const;
 	bool get_pin_enabled(int32_t p_effector_index) const;
 	void register_skeleton();
 	void reset_constraints();
 	Vector<Ref<IKBone3D>> get_bone_list() const;
+	Ref<IKBone3D> find_ik_bone(BoneId p_bone) const;
 	Vector<Ref<IKBoneSegment3D>> get_segmented_skeletons();
 	float get_iterations_per_frame() const;
 	void set_iterations_per_frame(const float &p_iterations_per_frame);
@@ -0,0 +1,92 @@
+/**************************************************************************/
+/*  many_bone_ik_3d_server.cpp                                            */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#include "many_bone_ik_3d_server.h"
+
+#include "many_bone_ik_3d.h"
+
+#include "core/object/worker_thread_pool.h"
+
+ManyBoneIK3DServer *ManyBoneIK3DServer::singleton = nullptr;
+
+ManyBoneIK3DServer *ManyBoneIK3DServer::get_singleton() {
+	return singleton;
+}
+
+void ManyBoneIK3DServer::register_instance(ManyBoneIK3D *p_instance) {
+	ERR_FAIL_NULL(p_instance);
+	ERR_FAIL_COND(instances.has(p_instance));
+	instances.push_back(p_instance);
+}
+
+void ManyBoneIK3DServer::unregister_instance(ManyBoneIK3D *p_instance) {
+	instances.erase(p_instance);
+}
+
+int32_t ManyBoneIK3DServer::get_instance_count() const {
+	return instances.size();
+}
+
+int32_t ManyBoneIK3DServer::solve_batch() {
+	// Gathering reads every skeleton on the calling thread. Modifications run after the animation has
+	// been applied, so each instance reads the same pose here that its own modification would. That only
+	// holds for instances that run first on their skeleton, which _begin_batched_solve() checks.
+	batch.clear();
+	for (ManyBoneIK3D *instance : instances) {
+		if (instance->_begin_batched_solve()) {
+			batch.push_back(instance);
+		}
+	}
+	if (batch.size() == 1) {
+		_solve_instance(0, batch.ptr());
+	} else if (batch.size() > 1) {
+		// Workers claim the next unsolved instance as they finish, so uneven rigs balance out.
+		WorkerThreadPool::GroupID group_id = WorkerThreadPool::get_singleton()->add_template_group_task(this, &ManyBoneIK3DServer::_solve_instance, batch.ptr(), batch.size(), -1, true, SNAME("ManyBoneIK3DServerBatch"));
+		WorkerThreadPool::get_singleton()->wait_for_group_task_completion(group_id);
+	}
+	return batch.size();
+}
+
+void ManyBoneIK3DServer::_solve_instance(uint32_t p_index, ManyBoneIK3D *const *p_batch) {
+	p_batch[p_index]->_solve(false);
+}
+
+void ManyBoneIK3DServer::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("get_instance_count"), &ManyBoneIK3DServer::get_instance_count);
+	ClassDB::bind_method(D_METHOD("solve_batch"), &ManyBoneIK3DServer::solve_batch);
+}
+
+ManyBoneIK3DServer::ManyBoneIK3DServer() {
+	singleton = this;
+}
+
+ManyBoneIK3DServer::~ManyBoneIK3DServer() {
+	singleton = nullptr;
+}
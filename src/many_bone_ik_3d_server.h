@@ -0,0 +1,64 @@
+/**************************************************************************/
+/*  many_bone_ik_3d_server.h                                              */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#pragma once
+
+#include "core/object/class_db.h"
+#include "core/object/object.h"
+#include "core/templates/local_vector.h"
+
+class ManyBoneIK3D;
+
+// Solves every registered ManyBoneIK3D in one parallel batch. The first registered instance whose
+// modification runs in a frame triggers the batch; the others then only write back their poses.
+class ManyBoneIK3DServer : public Object {
+	GDCLASS(ManyBoneIK3DServer, Object);
+
+	static ManyBoneIK3DServer *singleton;
+
+	LocalVector<ManyBoneIK3D *> instances;
+	LocalVector<ManyBoneIK3D *> batch;
+
+	void _solve_instance(uint32_t p_index, ManyBoneIK3D *const *p_batch);
+
+protected:
+	static void _bind_methods();
+
+public:
+	static ManyBoneIK3DServer *get_singleton();
+
+	void register_instance(ManyBoneIK3D *p_instance);
+	void unregister_instance(ManyBoneIK3D *p_instance);
+	int32_t get_instance_count() const;
+	int32_t solve_batch();
+
+	ManyBoneIK3DServer();
+	~ManyBoneIK3DServer();
+};
@@ -0,0 +1,96 @@
+/**************************************************************************/
+/*  many_bone_ik_3d_state.cpp                                             */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#include "many_bone_ik_3d_state.h"
+
+void ManyBoneIK3DState::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("get_skeleton_topology_hash"), &ManyBoneIK3DState::get_skeleton_topology_hash);
+	ClassDB::bind_method(D_METHOD("set_skeleton_topology_hash", "hash"), &ManyBoneIK3DState::set_skeleton_topology_hash);
+	ClassDB::bind_method(D_METHOD("get_bones"), &ManyBoneIK3DState::get_bones);
+	ClassDB::bind_method(D_METHOD("set_bones", "bones"), &ManyBoneIK3DState::set_bones);
+	ClassDB::bind_method(D_METHOD("get_bone_transforms"), &ManyBoneIK3DState::get_bone_transforms);
+	ClassDB::bind_method(D_METHOD("set_bone_transforms", "bone_transforms"), &ManyBoneIK3DState::set_bone_transforms);
+	ClassDB::bind_method(D_METHOD("get_segments"), &ManyBoneIK3DState::get_segments);
+	ClassDB::bind_method(D_METHOD("set_segments", "segments"), &ManyBoneIK3DState::set_segments);
+	ClassDB::bind_method(D_METHOD("get_steps"), &ManyBoneIK3DState::get_steps);
+	ClassDB::bind_method(D_METHOD("set_steps", "steps"), &ManyBoneIK3DState::set_steps);
+	ClassDB::bind_method(D_METHOD("get_step_damps"), &ManyBoneIK3DState::get_step_damps);
+	ClassDB::bind_method(D_METHOD("set_step_damps", "step_damps"), &ManyBoneIK3DState::set_step_damps);
+	ClassDB::bind_method(D_METHOD("get_root_segments"), &ManyBoneIK3DState::get_root_segments);
+	ClassDB::bind_method(D_METHOD("set_root_segments", "root_segments"), &ManyBoneIK3DState::set_root_segments);
+	ClassDB::bind_method(D_METHOD("get_segment_children"), &ManyBoneIK3DState::get_segment_children);
+	ClassDB::bind_method(D_METHOD("set_segment_children", "segment_children"), &ManyBoneIK3DState::set_segment_children);
+	ClassDB::bind_method(D_METHOD("get_segment_effectors"), &ManyBoneIK3DState::get_segment_effectors);
+	ClassDB::bind_method(D_METHOD("set_segment_effectors", "segment_effectors"), &ManyBoneIK3DState::set_segment_effectors);
+	ClassDB::bind_method(D_METHOD("get_heading_weights"), &ManyBoneIK3DState::get_heading_weights);
+	ClassDB::bind_method(D_METHOD("set_heading_weights", "heading_weights"), &ManyBoneIK3DState::set_heading_weights);
+	ClassDB::bind_method(D_METHOD("get_effector_bones"), &ManyBoneIK3DState::get_effector_bones);
+	ClassDB::bind_method(D_METHOD("set_effector_bones", "effector_bones"), &ManyBoneIK3DState::set_effector_bones);
+	ClassDB::bind_method(D_METHOD("get_effector_direction_priorities"), &ManyBoneIK3DState::get_effector_direction_priorities);
+	ClassDB::bind_method(D_METHOD("set_effector_direction_priorities", "direction_priorities"), &ManyBoneIK3DState::set_effector_direction_priorities);
+	ClassDB::bind_method(D_METHOD("get_effector_target_nodes"), &ManyBoneIK3DState::get_effector_target_nodes);
+	ClassDB::bind_method(D_METHOD("set_effector_target_nodes", "target_nodes"), &ManyBoneIK3DState::set_effector_target_nodes);
+	ClassDB::bind_method(D_METHOD("get_constraint_flags"), &ManyBoneIK3DState::get_constraint_flags);
+	ClassDB::bind_method(D_METHOD("set_constraint_flags", "flags"), &ManyBoneIK3DState::set_constraint_flags);
+	ClassDB::bind_method(D_METHOD("get_constraint_axial_limits"), &ManyBoneIK3DState::get_constraint_axial_limits);
+	ClassDB::bind_method(D_METHOD("set_constraint_axial_limits", "axial_limits"), &ManyBoneIK3DState::set_constraint_axial_limits);
+	ClassDB::bind_method(D_METHOD("get_constraint_cone_offsets"), &ManyBoneIK3DState::get_constraint_cone_offsets);
+	ClassDB::bind_method(D_METHOD("set_constraint_cone_offsets", "offsets"), &ManyBoneIK3DState::set_constraint_cone_offsets);
+	ClassDB::bind_method(D_METHOD("get_constraint_cones"), &ManyBoneIK3DState::get_constraint_cones);
+	ClassDB::bind_method(D_METHOD("set_constraint_cones", "cones"), &ManyBoneIK3DState::set_constraint_cones);
+	ClassDB::bind_method(D_METHOD("get_bone_count"), &ManyBoneIK3DState::get_bone_count);
+	ClassDB::bind_method(D_METHOD("is_empty"), &ManyBoneIK3DState::is_empty);
+
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "skeleton_topology_hash", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NO_EDITOR), "set_skeleton_topology_hash", "get_skeleton_topology_hash");
+	ADD_PROPERTY(PropertyInfo(Variant::PACKED_INT32_ARRAY, "bones", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NO_EDITOR), "set_bones", "get_bones");
+	ADD_PROPERTY(PropertyInfo(Variant::ARRAY, "bone_transforms", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NO_EDITOR), "set_bone_transforms", "get_bone_transforms");
+	ADD_PROPERTY(PropertyInfo(Variant::PACKED_INT32_ARRAY, "segments", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NO_EDITOR), "set_segments", "get_segments");
+	ADD_PROPERTY(PropertyInfo(Variant::PACKED_INT32_ARRAY, "steps", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NO_EDITOR), "set_steps", "get_steps");
+	ADD_PROPERTY(PropertyInfo(Variant::PACKED_FLOAT64_ARRAY, "step_damps", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NO_EDITOR), "set_step_damps", "get_step_damps");
+	ADD_PROPERTY(PropertyInfo(Variant::PACKED_INT32_ARRAY, "root_segments", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NO_EDITOR), "set_root_segments", "get_root_segments");
+	ADD_PROPERTY(PropertyInfo(Variant::PACKED_INT32_ARRAY, "segment_children", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NO_EDITOR), "set_segment_children", "get_segment_children");
+	ADD_PROPERTY(PropertyInfo(Variant::PACKED_INT32_ARRAY, "segment_effectors", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NO_EDITOR), "set_segment_effectors", "get_segment_effectors");
+	ADD_PROPERTY(PropertyInfo(Variant::PACKED_FLOAT64_ARRAY, "heading_weights", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NO_EDITOR), "set_heading_weights", "get_heading_weights");
+	ADD_PROPERTY(PropertyInfo(Variant::PACKED_INT32_ARRAY, "effector_bones", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NO_EDITOR), "set_effector_bones", "get_effector_bones");
+	ADD_PROPERTY(PropertyInfo(Variant::PACKED_VECTOR3_ARRAY, "effector_direction_priorities", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NO_EDITOR), "set_effector_direction_priorities", "get_effector_direction_priorities");
+	ADD_PROPERTY(PropertyInfo(Variant::ARRAY, "effector_target_nodes", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NO_EDITOR), "set_effector_target_nodes", "get_effector_target_nodes");
+	ADD_PROPERTY(PropertyInfo(Variant::PACKED_INT32_ARRAY, "constraint_flags", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NO_EDITOR), "set_constraint_flags", "get_constraint_flags");
+	ADD_PROPERTY(PropertyInfo(Variant::PACKED_VECTOR2_ARRAY, "constraint_axial_limits", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NO_EDITOR), "set_constraint_axial_limits", "get_constraint_axial_limits");
+	ADD_PROPERTY(PropertyInfo(Variant::PACKED_INT32_ARRAY, "constraint_cone_offsets", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NO_EDITOR), "set_constraint_cone_offsets", "get_constraint_cone_offsets");
+	ADD_PROPERTY(PropertyInfo(Variant::PACKED_FLOAT64_ARRAY, "constraint_cones", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_NO_EDITOR), "set_constraint_cones", "get_constraint_cones");
+}
+
+int32_t ManyBoneIK3DState::get_bone_count() const {
+	return bones.size() / BONE_STRIDE;
+}
+
+bool ManyBoneIK3DState::is_empty() const {
+	return bones.is_empty();
+}
@@ -0,0 +1,112 @@
+/**************************************************************************/
+/*  many_bone_ik_3d_state.h                                               */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#pragma once
+
+#include "core/io/resource.h"
+#include "core/variant/array.h"
+
+// Serialized copy of a compiled IKSolverRig3D. Applying it recreates the rig directly,
+// skipping segmentation, heading setup and the default bone direction pass.
+// The arrays are flat so that they load without any per bone object creation; see IKSolverRig3D for their layout.
+class ManyBoneIK3DState : public Resource {
+	GDCLASS(ManyBoneIK3DState, Resource);
+	friend class IKSolverRig3D;
+
+	int64_t skeleton_topology_hash = 0;
+	PackedInt32Array bones; // Per bone: bone id, parent, subtree end and constraint index.
+	Array bone_transforms; // Per bone: pose, bone direction, constraint orientation and constraint twist.
+	PackedInt32Array segments; // Per segment, the fields of IKSolverRig3D::Segment in declaration order.
+	PackedInt32Array steps; // Per step: bone and segment.
+	PackedFloat64Array step_damps;
+	PackedInt32Array root_segments;
+	PackedInt32Array segment_children;
+	PackedInt32Array segment_effectors;
+	PackedFloat64Array heading_weights;
+	PackedInt32Array effector_bones;
+	PackedVector3Array effector_direction_priorities;
+	Array effector_target_nodes;
+	PackedInt32Array constraint_flags;
+	PackedVector2Array constraint_axial_limits; // Minimum angle and range.
+	PackedInt32Array constraint_cone_offsets; // Per constraint plus one, the start of its cones.
+	PackedFloat64Array constraint_cones; // Per cone: control point and radius.
+
+protected:
+	static void _bind_methods();
+
+public:
+	enum ConstraintFlag {
+		CONSTRAINT_FLAG_ORIENTATIONAL = 1,
+		CONSTRAINT_FLAG_AXIAL = 2,
+	};
+	static const int32_t BONE_STRIDE = 4;
+	static const int32_t BONE_TRANSFORM_STRIDE = 4;
+	static const int32_t SEGMENT_STRIDE = 13;
+	static const int32_t STEP_STRIDE = 2;
+	static const int32_t CONE_STRIDE = 4;
+
+	int64_t get_skeleton_topology_hash() const { return skeleton_topology_hash; }
+	void set_skeleton_topology_hash(int64_t p_hash) { skeleton_topology_hash = p_hash; }
+	PackedInt32Array get_bones() const { return bones; }
+	void set_bones(const PackedInt32Array &p_bones) { bones = p_bones; }
+	Array get_bone_transforms() const { return bone_transforms; }
+	void set_bone_transforms(const Array &p_bone_transforms) { bone_transforms = p_bone_transforms; }
+	PackedInt32Array get_segments() const { return segments; }
+	void set_segments(const PackedInt32Array &p_segments) { segments = p_segments; }
+	PackedInt32Array get_steps() const { return steps; }
+	void set_steps(const PackedInt32Array &p_steps) { steps = p_steps; }
+	PackedFloat64Array get_step_damps() const { return step_damps; }
+	void set_step_damps(const PackedFloat64Array &p_step_damps) { step_damps = p_step_damps; }
+	PackedInt32Array get_root_segments() const { return root_segments; }
+	void set_root_segments(const PackedInt32Array &p_root_segments) { root_segments = p_root_segments; }
+	PackedInt32Array get_segment_children() const { return segment_children; }
+	void set_segment_children(const PackedInt32Array &p_segment_children) { segment_children = p_segment_children; }
+	PackedInt32Array get_segment_effectors() const { return segment_effectors; }
+	void set_segment_effectors(const PackedInt32Array &p_segment_effectors) { segment_effectors = p_segment_effectors; }
+	PackedFloat64Array get_heading_weights() const { return heading_weights; }
+	void set_heading_weights(const PackedFloat64Array &p_heading_weights) { heading_weights = p_heading_weights; }
+	PackedInt32Array get_effector_bones() const { return effector_bones; }
+	void set_effector_bones(const PackedInt32Array &p_effector_bones) { effector_bones = p_effector_bones; }
+	PackedVector3Array get_effector_direction_priorities() const { return effector_direction_priorities; }
+	void set_effector_direction_priorities(const PackedVector3Array &p_priorities) { effector_direction_priorities = p_priorities; }
+	Array get_effector_target_nodes() const { return effector_target_nodes; }
+	void set_effector_target_nodes(const Array &p_target_nodes) { effector_target_nodes = p_target_nodes; }
+	PackedInt32Array get_constraint_flags() const { return constraint_flags; }
+	void set_constraint_flags(const PackedInt32Array &p_flags) { constraint_flags = p_flags; }
+	PackedVector2Array get_constraint_axial_limits() const { return constraint_axial_limits; }
+	void set_constraint_axial_limits(const PackedVector2Array &p_axial_limits) { constraint_axial_limits = p_axial_limits; }
+	PackedInt32Array get_constraint_cone_offsets() const { return constraint_cone_offsets; }
+	void set_constraint_cone_offsets(const PackedInt32Array &p_offsets) { constraint_cone_offsets = p_offsets; }
+	PackedFloat64Array get_constraint_cones() const { return constraint_cones; }
+	void set_constraint_cones(const PackedFloat64Array &p_cones) { constraint_cones = p_cones; }
+
+	int32_t get_bone_count() const;
+	bool is_empty() const;
+};
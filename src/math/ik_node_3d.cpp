@@ -31,21 +31,13 @@
 #include "ik_node_3d.h"
 
 void IKNode3D::_propagate_transform_changed() {
-	Vector<Ref<IKNode3D>> to_remove;
-
-	for (Ref<IKNode3D> transform : children) {
-		if (transform.is_null()) {
-			to_remove.push_back(transform);
-		} else {
-			transform->_propagate_transform_changed();
-		}
+	if (dirty & DIRTY_SUBTREE) {
+		return;
 	}
-
-	for (Ref<IKNode3D> transform : to_remove) {
-		children.erase(transform);
+	dirty |= DIRTY_GLOBAL | DIRTY_SUBTREE;
+	for (const Ref<IKNode3D> &child : children) {
+		child->_propagate_transform_changed();
 	}
-
-	dirty |= DIRTY_GLOBAL;
 }
 
 void IKNode3D::_update_local_transform() const {
@@ -54,11 +46,10 @@ void IKNode3D::_update_local_transform() const {
 }
 
 void IKNode3D::rotate_local_with_global(const Basis &p_basis, bool p_propagate) {
-	if (parent.get_ref().is_null()) {
+	if (!parent) {
 		return;
 	}
-	Ref<IKNode3D> parent_ik_node = parent.get_ref();
-	const Basis &new_rot = parent_ik_node->get_global_transform().basis;
+	const Basis new_rot = parent->get_global_transform().basis;
 	local_transform.basis = new_rot.inverse() * p_basis * new_rot * local_transform.basis;
 	dirty |= DIRTY_GLOBAL;
 	if (p_propagate) {
@@ -75,8 +66,7 @@ void IKNode3D::set_transform(const Transform3D &p_transform) {
 }
 
 void IKNode3D::set_global_transform(const Transform3D &p_transform) {
-	Ref<IKNode3D> ik_node = parent.get_ref();
-	Transform3D xform = ik_node.is_valid() ? ik_node->get_global_transform().affine_inverse() * p_transform : p_transform;
+	Transform3D xform = parent ? parent->get_global_transform().affine_inverse() * p_transform : p_transform;
 	local_transform = xform;
 	dirty |= DIRTY_VECTORS;
 	_propagate_transform_changed();
@@ -95,9 +85,8 @@ Transform3D IKNode3D::get_global_transform() const {
 		if (dirty & DIRTY_LOCAL) {
 			_update_local_transform();
 		}
-		Ref<IKNode3D> ik_node = parent.get_ref();
-		if (ik_node.is_valid()) {
-			global_transform = ik_node->get_global_transform() * local_transform;
+		if (parent) {
+			global_transform = parent->get_global_transform() * local_transform;
 		} else {
 			global_transform = local_transform;
 		}
@@ -106,7 +95,7 @@ Transform3D IKNode3D::get_global_transform() const {
 			global_transform.basis.orthogonalize();
 		}
 
-		dirty &= ~DIRTY_GLOBAL;
+		dirty &= ~(DIRTY_GLOBAL | DIRTY_SUBTREE);
 	}
 
 	return global_transform;
@@ -121,18 +110,26 @@ bool IKNode3D::is_scale_disabled() const {
 }
 
 void IKNode3D::set_parent(Ref<IKNode3D> p_parent) {
-	if (p_parent.is_valid()) {
-		p_parent->children.erase(this);
-	}
-	parent.set_ref(p_parent);
-	if (p_parent.is_valid()) {
-		p_parent->children.push_back(this);
+	ERR_FAIL_COND(p_parent.ptr() == this);
+	if (parent != p_parent.ptr()) {
+		if (parent) {
+			for (uint32_t child_i = 0; child_i < parent->children.size(); child_i++) {
+				if (parent->children[child_i].ptr() == this) {
+					parent->children.remove_at_unordered(child_i);
+					break;
+				}
+			}
+		}
+		parent = p_parent.ptr();
+		if (parent) {
+			parent->children.push_back(Ref<IKNode3D>(this));
+		}
 	}
 	_propagate_transform_changed();
 }
 
 Ref<IKNode3D> IKNode3D::get_parent() const {
-	return parent.get_ref();
+	return Ref<IKNode3D>(parent);
 }
 
 Vector3 IKNode3D::to_local(const Vector3 &p_global) const {
@@ -153,7 +150,9 @@ void IKNode3D::_notification(int p_what) {
 	}
 }
 void IKNode3D::cleanup() {
-	for (Ref<IKNode3D> &child : children) {
-		child->set_parent(Ref<IKNode3D>());
+	for (const Ref<IKNode3D> &child : children) {
+		child->parent = nullptr;
+		child->_propagate_transform_changed();
 	}
+	children.clear();
 }
@@ -31,7 +31,7 @@
 #pragma once
 
 #include "core/object/ref_counted.h"
-#include "core/templates/list.h"
+#include "core/templates/local_vector.h"
 
 #include "core/io/resource.h"
 #include "core/math/transform_3d.h"
@@ -43,7 +43,10 @@ class IKNode3D : public RefCounted {
 		DIRTY_NONE = 0,
 		DIRTY_VECTORS = 1,
 		DIRTY_LOCAL = 2,
-		DIRTY_GLOBAL = 4
+		DIRTY_GLOBAL = 4,
+		// Set by _propagate_transform_changed and cleared with DIRTY_GLOBAL. While set, every descendant
+		// is DIRTY_GLOBAL as well, so propagating into this subtree again can stop here.
+		DIRTY_SUBTREE = 8
 	};
 
 	mutable Transform3D global_transform;
@@ -53,8 +56,9 @@ class IKNode3D : public RefCounted {
 
 	mutable int dirty = DIRTY_NONE;
 
-	WeakRef parent;
-	List<Ref<IKNode3D>> children;
+	// Not a reference: children are owned by their parent, and cleanup() detaches them before the parent is freed.
+	IKNode3D *parent = nullptr;
+	LocalVector<Ref<IKNode3D>> children;
 
 	bool disable_scale = false;
 
@@ -0,0 +1,90 @@
+/**************************************************************************/
+/*  ik_rigid_transform_3d.h                                               */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#pragma once
+
+#include "core/math/quaternion.h"
+#include "core/math/transform_3d.h"
+
+// A rotation, a translation and a uniform scale. Composing two of them is a quaternion product and one
+// rotated offset, and renormalizing the quaternion is all it takes to stay rigid, so the solve keeps its
+// poses in this form and only goes through Transform3D when it talks to the skeleton or the bone graph.
+struct IKRigidTransform3D {
+	Quaternion rotation;
+	Vector3 origin;
+	real_t scale = 1.0;
+
+	_FORCE_INLINE_ Vector3 xform(const Vector3 &p_vector) const {
+		return origin + rotation.xform(p_vector * scale);
+	}
+	_FORCE_INLINE_ Vector3 xform_inv(const Vector3 &p_vector) const {
+		return rotation.xform_inv(p_vector - origin) / scale;
+	}
+	// Like xform and xform_inv, without the translation.
+	_FORCE_INLINE_ Vector3 basis_xform(const Vector3 &p_vector) const {
+		return rotation.xform(p_vector * scale);
+	}
+	_FORCE_INLINE_ Vector3 basis_xform_inv(const Vector3 &p_vector) const {
+		return rotation.xform_inv(p_vector) / scale;
+	}
+	_FORCE_INLINE_ Vector3 get_column(int p_axis) const {
+		Vector3 axis;
+		axis[p_axis] = scale;
+		return rotation.xform(axis);
+	}
+
+	_FORCE_INLINE_ IKRigidTransform3D inverse() const {
+		IKRigidTransform3D inverse;
+		inverse.rotation = rotation.inverse();
+		inverse.scale = 1.0 / scale;
+		inverse.origin = inverse.rotation.xform(-origin) * inverse.scale;
+		return inverse;
+	}
+	_FORCE_INLINE_ IKRigidTransform3D operator*(const IKRigidTransform3D &p_transform) const {
+		return IKRigidTransform3D(rotation * p_transform.rotation, xform(p_transform.origin), scale * p_transform.scale);
+	}
+	IKRigidTransform3D interpolate_with(const IKRigidTransform3D &p_transform, real_t p_weight) const {
+		return IKRigidTransform3D(rotation.slerp(p_transform.rotation, p_weight), origin.lerp(p_transform.origin, p_weight), Math::lerp(scale, p_transform.scale, p_weight));
+	}
+
+	Transform3D to_transform() const {
+		return Transform3D(Basis(rotation, Vector3(scale, scale, scale)), origin);
+	}
+
+	IKRigidTransform3D() {}
+	IKRigidTransform3D(const Quaternion &p_rotation, const Vector3 &p_origin, real_t p_scale = 1.0) :
+			rotation(p_rotation), origin(p_origin), scale(p_scale) {}
+	// Shear is dropped and a non-uniform scale is averaged.
+	explicit IKRigidTransform3D(const Transform3D &p_transform) :
+			rotation(p_transform.basis.get_rotation_quaternion()), origin(p_transform.origin) {
+		Vector3 basis_scale = p_transform.basis.get_scale_abs();
+		scale = (basis_scale.x + basis_scale.y + basis_scale.z) / 3.0;
+	}
+};
@@ -30,240 +30,376 @@
 
 #include "qcp.h"
 
-QuaternionCharacteristicPolynomial::QuaternionCharacteristicPolynomial(double p_evec_prec) {
-	eigenvector_precision = p_evec_prec;
-}
+Quaternion QuaternionCharacteristicPolynomial::_calculate_single_rotation(const Vector3 &p_moved, const Vector3 &p_target) {
+	double norm_product = p_moved.length() * p_target.length();
+	if (norm_product == 0.0) {
+		return Quaternion();
+	}
 
-void QuaternionCharacteristicPolynomial::set(PackedVector3Array &r_target, PackedVector3Array &r_moved) {
-	target = r_target;
-	moved = r_moved;
-	transformation_calculated = false;
-	inner_product_calculated = false;
+	// Shortest arc taking p_moved onto p_target: axis m x t, half angle from (|m||t| + m.t, |m x t|).
+	double dot = p_moved.dot(p_target);
+	if (dot < ((2.0e-15 - 1.0) * norm_product)) {
+		// Opposite headings, any half turn about an orthogonal axis will do.
+		Vector3 axis = p_moved.cross(Math::abs(p_moved.x) > Math::abs(p_moved.z) ? Vector3(0, 0, 1) : Vector3(1, 0, 0)).normalized();
+		return Quaternion(axis.x, axis.y, axis.z, 0.0);
+	}
+	Vector3 axis = p_moved.cross(p_target);
+	return Quaternion(axis.x, axis.y, axis.z, norm_product + dot).normalized();
 }
 
-Quaternion QuaternionCharacteristicPolynomial::_get_rotation() {
-	if (!transformation_calculated) {
-		if (!inner_product_calculated) {
-			inner_product(target, moved);
+Quaternion QuaternionCharacteristicPolynomial::_calculate_rotation(const InnerProduct &p_inner_product, double p_precision) {
+	const InnerProduct &ip = p_inner_product;
+	double a11 = ip.sum_xx_plus_yy + ip.sum_zz - ip.max_eigenvalue;
+	double a12 = ip.sum_yz_minus_zy;
+	double a13 = -ip.sum_xz_minus_zx;
+	double a14 = ip.sum_xy_minus_yx;
+	double a21 = ip.sum_yz_minus_zy;
+	double a22 = ip.sum_xx_minus_yy - ip.sum_zz - ip.max_eigenvalue;
+	double a23 = ip.sum_xy_plus_yx;
+	double a24 = ip.sum_xz_plus_zx;
+	double a31 = a13;
+	double a32 = a23;
+	double a33 = ip.sum_yy - ip.sum_xx - ip.sum_zz - ip.max_eigenvalue;
+	double a34 = ip.sum_yz_plus_zy;
+	double a41 = a14;
+	double a42 = a24;
+	double a43 = a34;
+	double a44 = ip.sum_zz - ip.sum_xx_plus_yy - ip.max_eigenvalue;
+
+	double a3344_4334 = a33 * a44 - a43 * a34;
+	double a3244_4234 = a32 * a44 - a42 * a34;
+	double a3243_4233 = a32 * a43 - a42 * a33;
+	double a3143_4133 = a31 * a43 - a41 * a33;
+	double a3144_4134 = a31 * a44 - a41 * a34;
+	double a3142_4132 = a31 * a42 - a41 * a32;
+	double a1324_1423 = a13 * a24 - a14 * a23;
+	double a1224_1422 = a12 * a24 - a14 * a22;
+	double a1223_1322 = a12 * a23 - a13 * a22;
+	double a1124_1421 = a11 * a24 - a14 * a21;
+	double a1123_1321 = a11 * a23 - a13 * a21;
+	double a1122_1221 = a11 * a22 - a12 * a21;
+
+	// Every column of the adjugate of (K - lambda I) is parallel to the eigenvector. A column vanishes
+	// when the matching eigenvector component does, e.g. for half turns, so take the longest one.
+	Quaternion columns[4] = {
+		Quaternion(a21 * a3344_4334 - a23 * a3144_4134 + a24 * a3143_4133,
+				-a21 * a3244_4234 + a22 * a3144_4134 - a24 * a3142_4132,
+				a21 * a3243_4233 - a22 * a3143_4133 + a23 * a3142_4132,
+				a22 * a3344_4334 - a23 * a3244_4234 + a24 * a3243_4233),
+		Quaternion(a11 * a3344_4334 - a13 * a3144_4134 + a14 * a3143_4133,
+				-a11 * a3244_4234 + a12 * a3144_4134 - a14 * a3142_4132,
+				a11 * a3243_4233 - a12 * a3143_4133 + a13 * a3142_4132,
+				a12 * a3344_4334 - a13 * a3244_4234 + a14 * a3243_4233),
+		Quaternion(a41 * a1324_1423 - a43 * a1124_1421 + a44 * a1123_1321,
+				-a41 * a1224_1422 + a42 * a1124_1421 - a44 * a1122_1221,
+				a41 * a1223_1322 - a42 * a1123_1321 + a43 * a1122_1221,
+				a42 * a1324_1423 - a43 * a1224_1422 + a44 * a1223_1322),
+		Quaternion(a31 * a1324_1423 - a33 * a1124_1421 + a34 * a1123_1321,
+				-a31 * a1224_1422 + a32 * a1124_1421 - a34 * a1122_1221,
+				a31 * a1223_1322 - a32 * a1123_1321 + a33 * a1122_1221,
+				a32 * a1324_1423 - a33 * a1224_1422 + a34 * a1223_1322),
+	};
+	int32_t best_column = 0;
+	double qsqr = columns[0].length_squared();
+	for (int32_t column_i = 1; column_i < 4; column_i++) {
+		double column_qsqr = columns[column_i].length_squared();
+		if (column_qsqr > qsqr) {
+			qsqr = column_qsqr;
+			best_column = column_i;
 		}
-		rotation = calculate_rotation();
-		transformation_calculated = true;
 	}
-	return rotation;
-}
 
-Quaternion QuaternionCharacteristicPolynomial::calculate_rotation() {
-	Quaternion result;
+	// The cofactors are cubic in the eigenvalue; scaling the tolerance by it keeps the check independent of units.
+	double tolerance = p_precision * ip.initial_eigenvalue * ip.initial_eigenvalue * ip.initial_eigenvalue;
+	if (qsqr == 0.0 || qsqr < tolerance * tolerance) {
+		return Quaternion();
+	}
+	return columns[best_column].normalized();
+}
 
-	if (moved.size() == 1) {
-		Vector3 u = moved[0];
-		Vector3 v = target[0];
-		double norm_product = u.length() * v.length();
+void QuaternionCharacteristicPolynomial::_inner_product(const QCPMoments &p_moments, bool p_translate, InnerProduct &r_inner_product) {
+	InnerProduct &ip = r_inner_product;
+	double covariance[9];
+	double sum_of_squares1 = p_moments.target_squares;
+	double sum_of_squares2 = p_moments.moved_squares;
+	for (int k = 0; k < 9; k++) {
+		covariance[k] = p_moments.covariance[k];
+	}
 
-		if (norm_product == 0.0) {
-			return Quaternion();
+	if (p_translate && p_moments.weight_sum > 0) {
+		// Shift the raw moments to the weighted centroids: sum(w (t - tc)(m - mc)) = sum(w t m) - W tc mc.
+		const double inv_weight_sum = 1.0 / p_moments.weight_sum;
+		for (int row = 0; row < 3; row++) {
+			for (int column = 0; column < 3; column++) {
+				covariance[row * 3 + column] -= p_moments.target_sum[row] * p_moments.moved_sum[column] * inv_weight_sum;
+			}
 		}
-
-		double dot = u.dot(v);
-
-		if (dot < ((2.0e-15 - 1.0) * norm_product)) {
-			Vector3 w = u.normalized();
-			result = Quaternion(w.x, w.y, w.z, 0.0f).normalized();
-		} else {
-			double q0 = Math::sqrt(0.5 * (1.0 + dot / norm_product));
-			double coeff = 1.0 / (2.0 * q0 * norm_product);
-			Vector3 q = v.cross(u).normalized();
-			result = Quaternion(coeff * q.x, coeff * q.y, coeff * q.z, q0).normalized();
+		for (int axis = 0; axis < 3; axis++) {
+			sum_of_squares1 -= p_moments.target_sum[axis] * p_moments.target_sum[axis] * inv_weight_sum;
+			sum_of_squares2 -= p_moments.moved_sum[axis] * p_moments.moved_sum[axis] * inv_weight_sum;
 		}
-	} else {
-		double a13 = -sum_xz_minus_zx;
-		double a14 = sum_xy_minus_yx;
-		double a21 = sum_yz_minus_zy;
-		double a22 = sum_xx_minus_yy - sum_zz - max_eigenvalue;
-		double a23 = sum_xy_plus_yx;
-		double a24 = sum_xz_plus_zx;
-		double a31 = a13;
-		double a32 = a23;
-		double a33 = sum_yy - sum_xx - sum_zz - max_eigenvalue;
-		double a34 = sum_yz_plus_zy;
-		double a41 = a14;
-		double a42 = a24;
-		double a43 = a34;
-		double a44 = sum_zz - sum_xx_plus_yy - max_eigenvalue;
-
-		double a3344_4334 = a33 * a44 - a43 * a34;
-		double a3244_4234 = a32 * a44 - a42 * a34;
-		double a3243_4233 = a32 * a43 - a42 * a33;
-		double a3143_4133 = a31 * a43 - a41 * a33;
-		double a3144_4134 = a31 * a44 - a41 * a34;
-		double a3142_4132 = a31 * a42 - a41 * a32;
-
-		double quaternion_w = a22 * a3344_4334 - a23 * a3244_4234 + a24 * a3243_4233;
-		double quaternion_x = a21 * a3344_4334 - a23 * a3144_4134 + a24 * a3143_4133;
-		double quaternion_y = -a21 * a3244_4234 + a22 * a3144_4134 - a24 * a3142_4132;
-		double quaternion_z = a21 * a3243_4233 - a22 * a3143_4133 + a23 * a3142_4132;
+	}
 
-		double min_comp_val = quaternion_w;
-		min_comp_val = quaternion_x < min_comp_val ? quaternion_x : min_comp_val;
-		min_comp_val = quaternion_y < min_comp_val ? quaternion_y : min_comp_val;
-		min_comp_val = quaternion_z < min_comp_val ? quaternion_z : min_comp_val;
+	ip.sum_xx = covariance[0];
+	ip.sum_xy = covariance[1];
+	ip.sum_xz = covariance[2];
+	ip.sum_yx = covariance[3];
+	ip.sum_yy = covariance[4];
+	ip.sum_yz = covariance[5];
+	ip.sum_zx = covariance[6];
+	ip.sum_zy = covariance[7];
+	ip.sum_zz = covariance[8];
+
+	ip.initial_eigenvalue = (sum_of_squares1 + sum_of_squares2) * 0.5;
+
+	ip.sum_xz_plus_zx = ip.sum_xz + ip.sum_zx;
+	ip.sum_yz_plus_zy = ip.sum_yz + ip.sum_zy;
+	ip.sum_xy_plus_yx = ip.sum_xy + ip.sum_yx;
+	ip.sum_yz_minus_zy = ip.sum_yz - ip.sum_zy;
+	ip.sum_xz_minus_zx = ip.sum_xz - ip.sum_zx;
+	ip.sum_xy_minus_yx = ip.sum_xy - ip.sum_yx;
+	ip.sum_xx_plus_yy = ip.sum_xx + ip.sum_yy;
+	ip.sum_xx_minus_yy = ip.sum_xx - ip.sum_yy;
+	ip.max_eigenvalue = ip.initial_eigenvalue;
+}
 
-		if (!Math::is_zero_approx(min_comp_val)) {
-			quaternion_w /= min_comp_val;
-			quaternion_x /= min_comp_val;
-			quaternion_y /= min_comp_val;
-			quaternion_z /= min_comp_val;
+void QuaternionCharacteristicPolynomial::_refine_max_eigenvalue(InnerProduct &r_inner_product, double p_eigenvalue_precision, int32_t p_max_iterations) {
+	InnerProduct &ip = r_inner_product;
+	double sum_xx_2 = ip.sum_xx * ip.sum_xx;
+	double sum_yy_2 = ip.sum_yy * ip.sum_yy;
+	double sum_zz_2 = ip.sum_zz * ip.sum_zz;
+	double sum_xy_2 = ip.sum_xy * ip.sum_xy;
+	double sum_yz_2 = ip.sum_yz * ip.sum_yz;
+	double sum_xz_2 = ip.sum_xz * ip.sum_xz;
+	double sum_yx_2 = ip.sum_yx * ip.sum_yx;
+	double sum_zy_2 = ip.sum_zy * ip.sum_zy;
+	double sum_zx_2 = ip.sum_zx * ip.sum_zx;
+
+	double sum_xy_2_plus_xz_2_minus_yx_2_minus_zx_2 = sum_xy_2 + sum_xz_2 - sum_yx_2 - sum_zx_2;
+	double sum_yy_2_zz_2_minus_xx_2_plus_yz_2_zy_2 = sum_yy_2 + sum_zz_2 - sum_xx_2 + sum_yz_2 + sum_zy_2;
+	double sum_yz_zy_minus_yy_zz_2 = 2.0 * (ip.sum_yz * ip.sum_zy - ip.sum_yy * ip.sum_zz);
+	double sum_xx_plus_yy = ip.sum_xx_plus_yy;
+	double sum_xx_minus_yy = ip.sum_xx_minus_yy;
+	double sum_zz = ip.sum_zz;
+
+	// Coefficients of the characteristic polynomial x^4 + c2 x^2 + c1 x + c0 of the key matrix (Theobald 2005).
+	double c2 = -2.0 * (sum_xx_2 + sum_yy_2 + sum_zz_2 + sum_xy_2 + sum_yx_2 + sum_xz_2 + sum_zx_2 + sum_yz_2 + sum_zy_2);
+	double c1 = 8.0 * (ip.sum_xx * ip.sum_yz * ip.sum_zy + ip.sum_yy * ip.sum_zx * ip.sum_xz + ip.sum_zz * ip.sum_xy * ip.sum_yx - ip.sum_xx * ip.sum_yy * ip.sum_zz - ip.sum_yz * ip.sum_zx * ip.sum_xy - ip.sum_zy * ip.sum_yx * ip.sum_xz);
+	double c0 = sum_xy_2_plus_xz_2_minus_yx_2_minus_zx_2 * sum_xy_2_plus_xz_2_minus_yx_2_minus_zx_2 +
+			(sum_yy_2_zz_2_minus_xx_2_plus_yz_2_zy_2 + sum_yz_zy_minus_yy_zz_2) * (sum_yy_2_zz_2_minus_xx_2_plus_yz_2_zy_2 - sum_yz_zy_minus_yy_zz_2) +
+			(-(ip.sum_xz_plus_zx) * (ip.sum_yz_minus_zy) + (ip.sum_xy_minus_yx) * (sum_xx_minus_yy - sum_zz)) * (-(ip.sum_xz_minus_zx) * (ip.sum_yz_plus_zy) + (ip.sum_xy_minus_yx) * (sum_xx_minus_yy + sum_zz)) +
+			(-(ip.sum_xz_plus_zx) * (ip.sum_yz_plus_zy) - (ip.sum_xy_plus_yx) * (sum_xx_plus_yy - sum_zz)) * (-(ip.sum_xz_minus_zx) * (ip.sum_yz_minus_zy) - (ip.sum_xy_plus_yx) * (sum_xx_plus_yy + sum_zz)) +
+			(+(ip.sum_xy_plus_yx) * (ip.sum_yz_plus_zy) + (ip.sum_xz_plus_zx) * (sum_xx_minus_yy + sum_zz)) * (-(ip.sum_xy_minus_yx) * (ip.sum_yz_minus_zy) + (ip.sum_xz_plus_zx) * (sum_xx_plus_yy + sum_zz)) +
+			(+(ip.sum_xy_plus_yx) * (ip.sum_yz_minus_zy) + (ip.sum_xz_minus_zx) * (sum_xx_minus_yy - sum_zz)) * (-(ip.sum_xy_minus_yx) * (ip.sum_yz_plus_zy) + (ip.sum_xz_minus_zx) * (sum_xx_plus_yy - sum_zz));
+
+	// Newton-Raphson from the upper bound, which converges monotonically onto the largest root.
+	double eigenvalue = ip.initial_eigenvalue;
+	for (int32_t i = 0; i < p_max_iterations; i++) {
+		double previous_eigenvalue = eigenvalue;
+		double eigenvalue_2 = eigenvalue * eigenvalue;
+		double b = (eigenvalue_2 + c2) * eigenvalue;
+		double a = b + c1;
+		double denominator = 2.0 * eigenvalue_2 * eigenvalue + b + a;
+		if (denominator == 0.0) {
+			break;
 		}
+		double delta = (a * eigenvalue + c0) / denominator;
+		eigenvalue -= delta;
+		if (Math::abs(eigenvalue - previous_eigenvalue) < Math::abs(p_eigenvalue_precision * eigenvalue)) {
+			break;
+		}
+	}
+	if (Math::is_finite(eigenvalue)) {
+		ip.max_eigenvalue = eigenvalue;
+	}
+}
 
-		double qsqr = quaternion_w * quaternion_w + quaternion_x * quaternion_x + quaternion_y * quaternion_y + quaternion_z * quaternion_z;
-
-		if (qsqr < eigenvector_precision) {
-			result = Quaternion();
-		} else {
-			result = Quaternion(quaternion_x, quaternion_y, quaternion_z, quaternion_w).normalized();
+double QuaternionCharacteristicPolynomial::get_rotated_msd(const QCPMoments &p_moments, const Basis &p_rotation) {
+	if (p_moments.weight_sum <= 0) {
+		return 0;
+	}
+	// sum(w |t - R m|^2) = sum(w |t|^2) + sum(w |m|^2) - 2 sum_ij R_ij sum(w t_i m_j)
+	double cross = 0;
+	for (int row = 0; row < 3; row++) {
+		for (int column = 0; column < 3; column++) {
+			cross += p_rotation.rows[row][column] * p_moments.covariance[row * 3 + column];
 		}
 	}
+	double deviation = p_moments.target_squares + p_moments.moved_squares - 2.0 * cross;
+	return MAX(deviation, 0.0) / p_moments.weight_sum;
+}
 
+QCPResult QuaternionCharacteristicPolynomial::_superpose_single(const Vector3 &p_moved, const Vector3 &p_target, double p_weight, bool p_translate) {
+	QCPResult result;
+	if (p_translate) {
+		// Both headings collapse onto their own centroid, only the offset remains.
+		result.translation = p_weight > 0 ? p_target - p_moved : Vector3();
+		return result;
+	}
+	result.rotation = _calculate_single_rotation(p_moved, p_target);
+	result.rmsd = Math::abs(p_target.length() - p_moved.length());
 	return result;
 }
 
-void QuaternionCharacteristicPolynomial::translate(Vector3 r_translate, PackedVector3Array &r_x) {
-	for (Vector3 &p : r_x) {
-		p += r_translate;
+bool QuaternionCharacteristicPolynomial::_superpose_pair(const Vector3 *p_moved, const Vector3 *p_target, const double *p_weight, bool p_translate, QCPResult &r_result) {
+	const double weight_sum = p_weight[0] + p_weight[1];
+	if (weight_sum <= 0) {
+		return false;
+	}
+	if (p_translate) {
+		// Centered, both headings lie along their difference, so the shortest arc between the differences is optimal.
+		const Vector3 moved_difference = p_moved[0] - p_moved[1];
+		const Vector3 target_difference = p_target[0] - p_target[1];
+		const Vector3 moved_center = (p_moved[0] * p_weight[0] + p_moved[1] * p_weight[1]) / weight_sum;
+		const Vector3 target_center = (p_target[0] * p_weight[0] + p_target[1] * p_weight[1]) / weight_sum;
+		const double length_difference = target_difference.length() - moved_difference.length();
+		r_result.rotation = _calculate_single_rotation(moved_difference, target_difference);
+		r_result.translation = target_center - r_result.rotation.xform(moved_center);
+		r_result.rmsd = Math::abs(length_difference) * Math::sqrt(p_weight[0] * p_weight[1]) / weight_sum;
+		return true;
 	}
-}
 
-Vector3 QuaternionCharacteristicPolynomial::_get_translation() {
-	if (translate_enabled) {
-		return target_center - rotation.xform(moved_center);
+	// Optimal two-observation attitude (Markley 1993) on the unit headings, each weighted by w |t| |m|.
+	const double moved_length_0 = p_moved[0].length();
+	const double moved_length_1 = p_moved[1].length();
+	const double target_length_0 = p_target[0].length();
+	const double target_length_1 = p_target[1].length();
+	if (moved_length_0 == 0.0 || moved_length_1 == 0.0 || target_length_0 == 0.0 || target_length_1 == 0.0) {
+		return false;
+	}
+	const Vector3 moved_0 = p_moved[0] / moved_length_0;
+	const Vector3 moved_1 = p_moved[1] / moved_length_1;
+	const Vector3 target_0 = p_target[0] / target_length_0;
+	const Vector3 target_1 = p_target[1] / target_length_1;
+	Vector3 moved_normal = moved_0.cross(moved_1);
+	Vector3 target_normal = target_0.cross(target_1);
+	const double moved_normal_length = moved_normal.length();
+	const double target_normal_length = target_normal.length();
+	if (moved_normal_length < CMP_EPSILON || target_normal_length < CMP_EPSILON) {
+		return false;
+	}
+	moved_normal /= moved_normal_length;
+	target_normal /= target_normal_length;
+	const double normal_dot = 1.0 + target_normal.dot(moved_normal);
+	if (normal_dot < CMP_EPSILON) {
+		return false;
+	}
+	const double a0 = p_weight[0] * moved_length_0 * target_length_0;
+	const double a1 = p_weight[1] * moved_length_1 * target_length_1;
+	const Vector3 normal_cross = target_normal.cross(moved_normal);
+	const Vector3 normal_sum = target_normal + moved_normal;
+	const Vector3 heading_cross = target_0.cross(moved_0) * a0 + target_1.cross(moved_1) * a1;
+	const double alpha = normal_dot * (a0 * target_0.dot(moved_0) + a1 * target_1.dot(moved_1)) + normal_cross.dot(heading_cross);
+	const double beta = normal_sum.dot(heading_cross);
+	const double gamma = Math::sqrt(alpha * alpha + beta * beta);
+	Vector3 axis;
+	double w;
+	if (alpha >= 0.0) {
+		axis = normal_cross * (gamma + alpha) + normal_sum * beta;
+		w = (gamma + alpha) * normal_dot;
 	} else {
-		return Vector3();
+		axis = normal_cross * beta + normal_sum * (gamma - alpha);
+		w = beta * normal_dot;
+	}
+	// Markley's quaternion maps the frame, ours rotates the headings, hence the conjugate.
+	Quaternion rotation = Quaternion(-axis.x, -axis.y, -axis.z, w);
+	if (rotation.length_squared() == 0.0) {
+		return false;
 	}
+	r_result.rotation = rotation.normalized();
+	r_result.translation = Vector3();
+	const double deviation = p_weight[0] * r_result.rotation.xform(p_moved[0]).distance_squared_to(p_target[0]) +
+			p_weight[1] * r_result.rotation.xform(p_moved[1]).distance_squared_to(p_target[1]);
+	r_result.rmsd = Math::sqrt(deviation / weight_sum);
+	return true;
 }
 
-Vector3 QuaternionCharacteristicPolynomial::move_to_weighted_center(PackedVector3Array &r_to_center, Vector<double> &r_weight) {
-	Vector3 center;
-	double total_weight = 0;
-	bool weight_is_empty = r_weight.is_empty();
-	int size = r_to_center.size();
-
-	for (int i = 0; i < size; i++) {
-		if (!weight_is_empty) {
-			total_weight += r_weight[i];
-			center += r_to_center[i] * r_weight[i];
-		} else {
-			center += r_to_center[i];
-			total_weight++;
-		}
+QCPResult QuaternionCharacteristicPolynomial::superpose_moments(const QCPMoments &p_moments, bool p_translate, double p_precision, double p_eigenvalue_precision, int32_t p_max_iterations) {
+	QCPResult result;
+	InnerProduct inner_product;
+	_inner_product(p_moments, p_translate, inner_product);
+	_refine_max_eigenvalue(inner_product, p_eigenvalue_precision, p_max_iterations);
+	result.rotation = _calculate_rotation(inner_product, p_precision);
+	if (p_moments.weight_sum > 0) {
+		result.rmsd = Math::sqrt(Math::abs(2.0 * (inner_product.initial_eigenvalue - inner_product.max_eigenvalue) / p_moments.weight_sum));
 	}
-
-	if (total_weight > 0) {
-		center /= total_weight;
+	if (p_translate && p_moments.weight_sum > 0) {
+		const double inv_weight_sum = 1.0 / p_moments.weight_sum;
+		Vector3 moved_center = Vector3(p_moments.moved_sum[0], p_moments.moved_sum[1], p_moments.moved_sum[2]) * inv_weight_sum;
+		Vector3 target_center = Vector3(p_moments.target_sum[0], p_moments.target_sum[1], p_moments.target_sum[2]) * inv_weight_sum;
+		result.translation = target_center - result.rotation.xform(moved_center);
 	}
-
-	return center;
+	return result;
 }
 
-void QuaternionCharacteristicPolynomial::inner_product(PackedVector3Array &r_coords1, PackedVector3Array &r_coords2) {
-	Vector3 weighted_coord1, weighted_coord2;
-	double sum_of_squares1 = 0, sum_of_squares2 = 0;
-
-	sum_xx = 0;
-	sum_xy = 0;
-	sum_xz = 0;
-	sum_yx = 0;
-	sum_yy = 0;
-	sum_yz = 0;
-	sum_zx = 0;
-	sum_zy = 0;
-	sum_zz = 0;
-
-	bool weight_is_empty = weight.is_empty();
-	int size = r_coords1.size();
-
-	for (int i = 0; i < size; i++) {
-		if (!weight_is_empty) {
-			weighted_coord1 = weight[i] * r_coords1[i];
-			sum_of_squares1 += weighted_coord1.dot(r_coords1[i]);
-		} else {
-			weighted_coord1 = r_coords1[i];
-			sum_of_squares1 += weighted_coord1.dot(weighted_coord1);
-		}
-
-		weighted_coord2 = r_coords2[i];
-
-		sum_of_squares2 += weight_is_empty ? weighted_coord2.dot(weighted_coord2) : (weight[i] * weighted_coord2.dot(weighted_coord2));
-
-		sum_xx += (weighted_coord1.x * weighted_coord2.x);
-		sum_xy += (weighted_coord1.x * weighted_coord2.y);
-		sum_xz += (weighted_coord1.x * weighted_coord2.z);
-
-		sum_yx += (weighted_coord1.y * weighted_coord2.x);
-		sum_yy += (weighted_coord1.y * weighted_coord2.y);
-		sum_yz += (weighted_coord1.y * weighted_coord2.z);
-
-		sum_zx += (weighted_coord1.z * weighted_coord2.x);
-		sum_zy += (weighted_coord1.z * weighted_coord2.y);
-		sum_zz += (weighted_coord1.z * weighted_coord2.z);
+QCPResult QuaternionCharacteristicPolynomial::superpose_soa(const QCPHeadings &p_moved, const QCPHeadings &p_target, const double *p_weight, int32_t p_count, bool p_translate, double p_precision,
+		double p_eigenvalue_precision, int32_t p_max_iterations, QCPMoments *r_moments) {
+	if (p_count <= 0) {
+		return QCPResult();
 	}
-
-	double initial_eigenvalue = (sum_of_squares1 + sum_of_squares2) * 0.5;
-
-	sum_xz_plus_zx = sum_xz + sum_zx;
-	sum_yz_plus_zy = sum_yz + sum_zy;
-	sum_xy_plus_yx = sum_xy + sum_yx;
-	sum_yz_minus_zy = sum_yz - sum_zy;
-	sum_xz_minus_zx = sum_xz - sum_zx;
-	sum_xy_minus_yx = sum_xy - sum_yx;
-	sum_xx_plus_yy = sum_xx + sum_yy;
-	sum_xx_minus_yy = sum_xx - sum_yy;
-	max_eigenvalue = initial_eigenvalue;
-
-	inner_product_calculated = true;
+	QCPMoments moments;
+	_accumulate_moments(p_moved, p_target, p_weight, p_count, moments);
+	if (r_moments) {
+		*r_moments = moments;
+	}
+	if (p_count == 1) {
+		return _superpose_single(Vector3(p_moved.x[0], p_moved.y[0], p_moved.z[0]), Vector3(p_target.x[0], p_target.y[0], p_target.z[0]), p_weight[0], p_translate);
+	}
+	return superpose_moments(moments, p_translate, p_precision, p_eigenvalue_precision, p_max_iterations);
 }
 
-Quaternion QuaternionCharacteristicPolynomial::_weighted_superpose(PackedVector3Array &p_moved, PackedVector3Array &p_target, Vector<double> &p_weight, bool p_translate) {
-	set(p_moved, p_target, p_weight, p_translate);
-	return _get_rotation();
+void QuaternionCharacteristicPolynomial::_accumulate_small_moments(const Vector3 *p_moved, const Vector3 *p_target, const double *p_weight, int32_t p_count, QCPMoments &r_moments) {
+	r_moments = QCPMoments();
+	for (int32_t i = 0; i < p_count; i++) {
+		r_moments.add(p_weight[i], p_target[i], p_moved[i]);
+	}
 }
 
-void QuaternionCharacteristicPolynomial::set(PackedVector3Array &p_moved_param, PackedVector3Array &p_target_param, Vector<double> &p_weight_param, bool p_translate_param) {
-	transformation_calculated = false;
-	inner_product_calculated = false;
-
-	moved = p_moved_param;
-	target = p_target_param;
-	weight = p_weight_param;
-	translate_enabled = p_translate_param;
-
-	if (translate_enabled) {
-		moved_center = move_to_weighted_center(p_moved_param, p_weight_param);
-		target_center = move_to_weighted_center(p_target_param, p_weight_param);
-
-		translate(moved_center * -1, moved);
-		translate(target_center * -1, target);
+void QuaternionCharacteristicPolynomial::_accumulate_moments(const QCPHeadings &p_moved, const QCPHeadings &p_target, const double *p_weight, int32_t p_count, QCPMoments &r_moments) {
+	r_moments = QCPMoments();
+	for (int32_t i = 0; i < p_count; i++) {
+		r_moments.add(p_weight[i], Vector3(p_target.x[i], p_target.y[i], p_target.z[i]), Vector3(p_moved.x[i], p_moved.y[i], p_moved.z[i]));
+	}
+}
 
-		w_sum = 0;
-		if (!weight.is_empty()) {
-			for (int i = 0; i < weight.size(); i++) {
-				w_sum += weight[i];
-			}
-		} else {
-			w_sum = moved.size();
-		}
+QCPResult QuaternionCharacteristicPolynomial::superpose_small(const Vector3 *p_moved, const Vector3 *p_target, const double *p_weight, int32_t p_count, bool p_translate, double p_precision,
+		double p_eigenvalue_precision, int32_t p_max_iterations, QCPMoments *r_moments) {
+	ERR_FAIL_COND_V(p_count > MAX_SMALL_COUNT, QCPResult());
+	if (p_count <= 0) {
+		return QCPResult();
+	}
+	QCPMoments moments;
+	_accumulate_small_moments(p_moved, p_target, p_weight, p_count, moments);
+	if (r_moments) {
+		*r_moments = moments;
+	}
+	if (p_count == 1) {
+		return _superpose_single(p_moved[0], p_target[0], p_weight[0], p_translate);
+	}
+	QCPResult result;
+	if (p_count == 2 && _superpose_pair(p_moved, p_target, p_weight, p_translate, result)) {
+		return result;
+	}
+	// Three headings, or a degenerate pair: only the eigenvalue solve is shared with the general path.
+	return superpose_moments(moments, p_translate, p_precision, p_eigenvalue_precision, p_max_iterations);
+}
 
-	} else {
-		moved_center = Vector3();
-		target_center = Vector3();
-		w_sum = 0;
-		if (!weight.is_empty()) {
-			for (int i = 0; i < weight.size(); i++) {
-				w_sum += weight[i];
-			}
-		} else {
-			w_sum = moved.size();
-		}
+QCPResult QuaternionCharacteristicPolynomial::superpose(const Vector3 *p_moved, const Vector3 *p_target, const double *p_weight, int32_t p_count, bool p_translate, double p_precision, QCPScratch &r_scratch,
+		double p_eigenvalue_precision, int32_t p_max_iterations) {
+	if (p_count <= 0) {
+		return QCPResult();
+	}
+	if (r_scratch.moved.size() < uint32_t(p_count)) {
+		r_scratch.moved.resize(p_count);
+		r_scratch.target.resize(p_count);
+		r_scratch.weight.resize(p_count);
+	}
+	for (int32_t i = 0; i < p_count; i++) {
+		r_scratch.moved.set(i, p_moved[i]);
+		r_scratch.target.set(i, p_target[i]);
+		r_scratch.weight[i] = p_weight ? p_weight[i] : 1.0;
 	}
+	return superpose_soa(r_scratch.moved.view(), r_scratch.target.view(), r_scratch.weight.ptr(), p_count, p_translate, p_precision, p_eigenvalue_precision, p_max_iterations);
 }
 
 void QuaternionCharacteristicPolynomial::_bind_methods() {
@@ -277,12 +413,12 @@ Array QuaternionCharacteristicPolynomial::weighted_superpose(PackedVector3Array
 		PackedVector3Array p_target,
 		Vector<double> p_weight, bool p_translate,
 		double p_precision) {
-	QuaternionCharacteristicPolynomial qcp(p_precision);
-	Quaternion rotation =
-			qcp._weighted_superpose(p_moved, p_target, p_weight, p_translate);
-	Vector3 translation = qcp._get_translation();
+	ERR_FAIL_COND_V(p_moved.size() != p_target.size(), Array());
+	ERR_FAIL_COND_V(!p_weight.is_empty() && p_weight.size() < p_moved.size(), Array());
+	QCPScratch scratch;
+	QCPResult superpose_result = superpose(p_moved.ptr(), p_target.ptr(), p_weight.is_empty() ? nullptr : p_weight.ptr(), p_moved.size(), p_translate, p_precision, scratch);
 	Array result;
-	result.push_back(rotation);
-	result.push_back(translation);
+	result.push_back(superpose_result.rotation);
+	result.push_back(superpose_result.translation);
 	return result;
 }
@@ -30,10 +30,14 @@
 
 #pragma once
 
+#include "core/math/basis.h"
+#include "core/math/quaternion.h"
 #include "core/math/vector3.h"
 #include "core/object/class_db.h"
 #include "core/object/object.h"
+#include "core/templates/local_vector.h"
 #include "core/variant/variant.h"
+#include "qcp_kernel.h"
 
 /**
  * Implementation of the Quaternion-Based Characteristic Polynomial algorithm
@@ -67,39 +71,90 @@
  * @author K. S. Ernest (iFire) Lee (adapted to ManyBoneIK)
  */
 
-class QuaternionCharacteristicPolynomial : Object {
-	GDCLASS(QuaternionCharacteristicPolynomial, Object);
-	double eigenvector_precision = 1E-6;
+struct QCPResult {
+	Quaternion rotation;
+	Vector3 translation;
+	double rmsd = 0; // Weighted root mean square deviation left after the superposition.
+};
 
-	PackedVector3Array target, moved;
-	Vector<double> weight;
-	double w_sum = 0;
+// Caller-owned storage used to convert array-of-structs headings, reused across calls.
+struct QCPScratch {
+	QCPHeadingBuffer moved;
+	QCPHeadingBuffer target;
+	LocalVector<double> weight;
+};
 
-	Vector3 target_center, moved_center;
-	Quaternion rotation;
-	bool translate_enabled = false;
+class QuaternionCharacteristicPolynomial : Object {
+	GDCLASS(QuaternionCharacteristicPolynomial, Object);
 
-	double sum_xy = 0, sum_xz = 0, sum_yx = 0, sum_yz = 0, sum_zx = 0, sum_zy = 0;
-	double sum_xx_plus_yy = 0, sum_zz = 0, max_eigenvalue = 0, sum_yz_minus_zy = 0, sum_xz_minus_zx = 0, sum_xy_minus_yx = 0;
-	double sum_xx_minus_yy = 0, sum_xy_plus_yx = 0, sum_xz_plus_zx = 0;
-	double sum_yy = 0, sum_xx = 0, sum_yz_plus_zy = 0;
-	bool transformation_calculated = false, inner_product_calculated = false;
+	struct InnerProduct {
+		double sum_xy = 0, sum_xz = 0, sum_yx = 0, sum_yz = 0, sum_zx = 0, sum_zy = 0;
+		double sum_xx_plus_yy = 0, sum_zz = 0, max_eigenvalue = 0, sum_yz_minus_zy = 0, sum_xz_minus_zx = 0, sum_xy_minus_yx = 0;
+		double sum_xx_minus_yy = 0, sum_xy_plus_yx = 0, sum_xz_plus_zx = 0;
+		double sum_yy = 0, sum_xx = 0, sum_yz_plus_zy = 0;
+		double initial_eigenvalue = 0;
+	};
 
-	void inner_product(PackedVector3Array &coords1, PackedVector3Array &coords2);
-	void set(PackedVector3Array &r_target, PackedVector3Array &r_moved);
-	Quaternion calculate_rotation();
-	void set(PackedVector3Array &p_moved, PackedVector3Array &p_target, Vector<double> &p_weight, bool p_translate);
-	static void translate(Vector3 r_translate, PackedVector3Array &r_x);
-	Vector3 move_to_weighted_center(PackedVector3Array &r_to_center, Vector<double> &r_weight);
-	QuaternionCharacteristicPolynomial(double p_evec_prec);
-	Quaternion _weighted_superpose(PackedVector3Array &p_moved, PackedVector3Array &p_target, Vector<double> &p_weight, bool translate);
-	Quaternion _get_rotation();
-	Vector3 _get_translation();
+	static void _inner_product(const QCPMoments &p_moments, bool p_translate, InnerProduct &r_inner_product);
+	static void _refine_max_eigenvalue(InnerProduct &r_inner_product, double p_eigenvalue_precision, int32_t p_max_iterations);
+	static Quaternion _calculate_rotation(const InnerProduct &p_inner_product, double p_precision);
+	static Quaternion _calculate_single_rotation(const Vector3 &p_moved, const Vector3 &p_target);
+	static QCPResult _superpose_single(const Vector3 &p_moved, const Vector3 &p_target, double p_weight, bool p_translate);
+	static bool _superpose_pair(const Vector3 *p_moved, const Vector3 *p_target, const double *p_weight, bool p_translate, QCPResult &r_result);
+	static void _accumulate_small_moments(const Vector3 *p_moved, const Vector3 *p_target, const double *p_weight, int32_t p_count, QCPMoments &r_moments);
+	static void _accumulate_moments(const QCPHeadings &p_moved, const QCPHeadings &p_target, const double *p_weight, int32_t p_count, QCPMoments &r_moments);
 
 protected:
 	static void _bind_methods();
 
 public:
+	static constexpr double DEFAULT_EIGENVALUE_PRECISION = 1E-11;
+	static constexpr int32_t DEFAULT_MAX_ITERATIONS = 50;
+	static constexpr int32_t MAX_SMALL_COUNT = 3;
+
+	/**
+	 * Finds the rotation (and optionally translation) that best superposes p_moved onto p_target.
+	 * Does not allocate once r_scratch has grown to p_count.
+	 *
+	 * @param p_weight one weight per heading, or nullptr for uniform weights.
+	 * @param p_precision below this squared eigenvector norm the rotation is left as identity.
+	 * @param p_eigenvalue_precision relative tolerance of the Newton-Raphson solve for the largest eigenvalue.
+	 * @param p_max_iterations cap on the Newton-Raphson iterations.
+	 */
+	static QCPResult superpose(const Vector3 *p_moved, const Vector3 *p_target, const double *p_weight, int32_t p_count, bool p_translate, double p_precision, QCPScratch &r_scratch,
+			double p_eigenvalue_precision = DEFAULT_EIGENVALUE_PRECISION, int32_t p_max_iterations = DEFAULT_MAX_ITERATIONS);
+
+	/**
+	 * Same as superpose, but reads the headings in structure-of-arrays form and never allocates.
+	 *
+	 * @param p_weight one weight per heading, must not be nullptr.
+	 * @param r_moments if not nullptr, receives the raw moments of the headings.
+	 */
+	static QCPResult superpose_soa(const QCPHeadings &p_moved, const QCPHeadings &p_target, const double *p_weight, int32_t p_count, bool p_translate, double p_precision,
+			double p_eigenvalue_precision = DEFAULT_EIGENVALUE_PRECISION, int32_t p_max_iterations = DEFAULT_MAX_ITERATIONS, QCPMoments *r_moments = nullptr);
+
+	/**
+	 * Superposition from already gathered moments, e.g. summed per effector instead of per heading.
+	 * A lone heading leaves the spin about itself free, so use superpose_small for those.
+	 */
+	static QCPResult superpose_moments(const QCPMoments &p_moments, bool p_translate, double p_precision,
+			double p_eigenvalue_precision = DEFAULT_EIGENVALUE_PRECISION, int32_t p_max_iterations = DEFAULT_MAX_ITERATIONS);
+
+	/**
+	 * Closed-form superposition for at most MAX_SMALL_COUNT headings, skipping the structure-of-arrays setup.
+	 * One heading takes the shortest arc and two use the optimal two-observation attitude. Three
+	 * headings, or a degenerate pair, go straight to the eigenvalue solve on the inline covariance.
+	 *
+	 * @param p_weight one weight per heading, must not be nullptr.
+	 */
+	static QCPResult superpose_small(const Vector3 *p_moved, const Vector3 *p_target, const double *p_weight, int32_t p_count, bool p_translate, double p_precision,
+			double p_eigenvalue_precision = DEFAULT_EIGENVALUE_PRECISION, int32_t p_max_iterations = DEFAULT_MAX_ITERATIONS, QCPMoments *r_moments = nullptr);
+
+	/**
+	 * Weighted mean square deviation between the target headings and the moved headings
+	 * rotated by p_rotation, evaluated from the raw moments alone.
+	 */
+	static double get_rotated_msd(const QCPMoments &p_moments, const Basis &p_rotation);
 	static Array weighted_superpose(PackedVector3Array p_moved,
 			PackedVector3Array p_target,
 			Vector<double> p_weight, bool p_translate,
@@ -0,0 +1,114 @@
+/**************************************************************************/
+/*  qcp_kernel.h                                                          */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#pragma once
+
+#include "core/math/vector3.h"
+#include "core/templates/local_vector.h"
+
+// Read-only structure-of-arrays view of a set of headings.
+struct QCPHeadings {
+	const double *x = nullptr;
+	const double *y = nullptr;
+	const double *z = nullptr;
+};
+
+// Structure-of-arrays storage for headings.
+struct QCPHeadingBuffer {
+	LocalVector<double> x;
+	LocalVector<double> y;
+	LocalVector<double> z;
+
+	void resize(uint32_t p_size) {
+		x.resize(p_size);
+		y.resize(p_size);
+		z.resize(p_size);
+	}
+	uint32_t size() const {
+		return x.size();
+	}
+	_FORCE_INLINE_ void set(uint32_t p_index, const Vector3 &p_heading) {
+		x[p_index] = p_heading.x;
+		y[p_index] = p_heading.y;
+		z[p_index] = p_heading.z;
+	}
+	_FORCE_INLINE_ Vector3 get(uint32_t p_index) const {
+		return Vector3(x[p_index], y[p_index], z[p_index]);
+	}
+	QCPHeadings view() const {
+		QCPHeadings headings;
+		headings.x = x.ptr();
+		headings.y = y.ptr();
+		headings.z = z.ptr();
+		return headings;
+	}
+};
+
+// Raw weighted moments of two heading sets, gathered in a single pass.
+struct QCPMoments {
+	double weight_sum = 0;
+	double moved_sum[3] = { 0, 0, 0 }; // Sum of w * moved.
+	double target_sum[3] = { 0, 0, 0 }; // Sum of w * target.
+	double covariance[9] = { 0, 0, 0, 0, 0, 0, 0, 0, 0 }; // Row-major sum of w * target[row] * moved[column].
+	double moved_squares = 0; // Sum of w * |moved|^2.
+	double target_squares = 0; // Sum of w * |target|^2.
+
+	_FORCE_INLINE_ void add(double p_weight, const Vector3 &p_target, const Vector3 &p_moved) {
+		weight_sum += p_weight;
+		for (int row = 0; row < 3; row++) {
+			const double weighted_target = p_weight * p_target[row];
+			moved_sum[row] += p_weight * p_moved[row];
+			target_sum[row] += weighted_target;
+			for (int column = 0; column < 3; column++) {
+				covariance[row * 3 + column] += weighted_target * p_moved[column];
+			}
+		}
+		moved_squares += p_weight * p_moved.length_squared();
+		target_squares += p_weight * p_target.length_squared();
+	}
+
+	// Adds the two headings target +/- target_offset and moved +/- moved_offset in one step.
+	// The odd terms cancel, leaving 2w (t m^T + dt dm^T) for the covariance.
+	_FORCE_INLINE_ void add_symmetric_pair(double p_weight, const Vector3 &p_target, const Vector3 &p_target_offset, const Vector3 &p_moved, const Vector3 &p_moved_offset) {
+		const double pair_weight = 2.0 * p_weight;
+		weight_sum += pair_weight;
+		for (int row = 0; row < 3; row++) {
+			const double weighted_target = pair_weight * p_target[row];
+			const double weighted_target_offset = pair_weight * p_target_offset[row];
+			moved_sum[row] += pair_weight * p_moved[row];
+			target_sum[row] += weighted_target;
+			for (int column = 0; column < 3; column++) {
+				covariance[row * 3 + column] += weighted_target * p_moved[column] + weighted_target_offset * p_moved_offset[column];
+			}
+		}
+		moved_squares += pair_weight * (p_moved.length_squared() + p_moved_offset.length_squared());
+		target_squares += pair_weight * (p_target.length_squared() + p_target_offset.length_squared());
+	}
+};
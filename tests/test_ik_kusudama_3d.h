@@ -54,12 +54,9 @@ TEST_CASE("[Modules][ManyBoneIK][IKKusudama3D] Test a point inside or on the bou
 	TypedArray<IKLimitCone3D> open_cones = kusudama->get_open_cones();
 	REQUIRE(open_cones.size() == 1);
 
-	Vector<double> bounds;
-	bounds.resize(2);
-	bounds.write[0] = 0;
-	bounds.write[1] = 0;
-	Vector3 returned_point_outside = kusudama->get_local_point_in_limits(limit_cone_control_point, &bounds);
-	CHECK(bounds[0] > 0);
+	double bounds = 0;
+	Vector3 returned_point_outside = kusudama->get_local_point_in_limits(limit_cone_control_point, bounds);
+	CHECK(bounds > 0);
 	CHECK(returned_point_outside == limit_cone_control_point);
 }
 
@@ -83,12 +80,9 @@ TEST_CASE("[Modules][ManyBoneIK][IKKusudama3D] Test a point inside or on the bou
 	TypedArray<IKLimitCone3D> open_cones = kusudama->get_open_cones();
 	CHECK_EQ(open_cones.size(), 1);
 
-	Vector<double> bounds;
-	bounds.resize(2);
-	bounds.write[0] = 0;
-	bounds.write[1] = 0;
-	Vector3 returned_point_outside = kusudama->get_local_point_in_limits(limit_cone_control_point, &bounds);
-	CHECK_LT(bounds[0], 0);
+	double bounds = 0;
+	Vector3 returned_point_outside = kusudama->get_local_point_in_limits(limit_cone_control_point, bounds);
+	CHECK_LT(bounds, 0);
 	CHECK(returned_point_outside.is_equal_approx(limit_cone_control_point));
 }
 
@@ -112,14 +106,11 @@ TEST_CASE("[Modules][ManyBoneIK][IKKusudama3D] Test a point outside the bounds w
 	TypedArray<IKLimitCone3D> open_cones = kusudama->get_open_cones();
 	REQUIRE(open_cones.size() == 1);
 
-	Vector<double> bounds;
-	bounds.resize(2);
-	bounds.write[0] = 0;
-	bounds.write[1] = 0;
+	double bounds = 0;
 
 	Vector3 test_point_outside = Vector3(1, 0, 0);
-	Vector3 returned_point_outside = kusudama->get_local_point_in_limits(test_point_outside, &bounds);
-	CHECK_EQ(bounds[0], -1);
+	Vector3 returned_point_outside = kusudama->get_local_point_in_limits(test_point_outside, bounds);
+	CHECK_EQ(bounds, -1);
 	CHECK(returned_point_outside.is_equal_approx(limit_cone_control_point));
 }
 
@@ -143,14 +134,11 @@ TEST_CASE("[Modules][ManyBoneIK][IKKusudama3D] Test a point outside the bounds w
 	TypedArray<IKLimitCone3D> open_cones = kusudama->get_open_cones();
 	REQUIRE(open_cones.size() == 1);
 
-	Vector<double> bounds;
-	bounds.resize(2);
-	bounds.write[0] = 0;
-	bounds.write[1] = 0;
+	double bounds = 0;
 
 	Vector3 test_point_outside = Vector3(1, 0, 0);
-	Vector3 returned_point_outside = kusudama->get_local_point_in_limits(test_point_outside, &bounds);
-	CHECK_EQ(bounds[0], -1);
+	Vector3 returned_point_outside = kusudama->get_local_point_in_limits(test_point_outside, bounds);
+	CHECK_EQ(bounds, -1);
 	CHECK(returned_point_outside.is_equal_approx(Vector3(0.50000001261839133, 0, 0.86602539649920684)));
 }
 
@@ -290,4 +278,114 @@ TEST_CASE("[Modules][ManyBoneIK][IKKusudama3D] Check limit cones clear functiona
 	open_cones = kusudama->get_open_cones();
 	CHECK(open_cones.size() == 0); // Expect no limit cones to remain
 }
+
+// Three connected cones, so the search covers both the cones and the paths between them.
+static Ref<IKKusudama3D> create_three_cone_kusudama() {
+	Ref<IKKusudama3D> kusudama;
+	kusudama.instantiate();
+	kusudama->resize_open_cones(3);
+	kusudama->get_open_cone(0)->set_control_point(Vector3(1, 0, 0));
+	kusudama->get_open_cone(0)->set_radius(Math::PI / 6);
+	kusudama->get_open_cone(1)->set_control_point(Vector3(0, 1, 0));
+	kusudama->get_open_cone(1)->set_radius(Math::PI / 8);
+	kusudama->get_open_cone(2)->set_control_point(Vector3(0, 0.5, 1).normalized());
+	kusudama->get_open_cone(2)->set_radius(Math::PI / 5);
+	kusudama->update_tangent_radii();
+	return kusudama;
+}
+
+// The search get_local_point_in_limits used to run over the cone resources, before the cones were baked.
+static Vector3 get_resource_point_in_limits(const Ref<IKKusudama3D> &p_kusudama, const Vector3 &p_in_point, bool &r_in_bounds) {
+	const Vector3 point = p_in_point.normalized();
+	const int32_t cone_count = p_kusudama->get_open_cones().size();
+	Vector<double> in_bounds = { -1.0 };
+	Vector3 closest = point;
+	real_t closest_cos = -2.0;
+	r_in_bounds = false;
+	for (int32_t cone_i = 0; cone_i < cone_count; cone_i++) {
+		Vector3 collision_point = p_kusudama->get_open_cone(cone_i)->closest_to_cone(point, &in_bounds);
+		if (Math::is_nan(collision_point.x)) {
+			r_in_bounds = true;
+			return point;
+		}
+		if (closest.is_zero_approx() || collision_point.dot(point) > closest_cos) {
+			closest = collision_point;
+			closest_cos = collision_point.dot(point);
+		}
+	}
+	for (int32_t cone_i = 0; cone_i < cone_count - 1; cone_i++) {
+		Vector3 collision_point = p_kusudama->get_open_cone(cone_i)->get_on_great_tangent_triangle(p_kusudama->get_open_cone(cone_i + 1), point);
+		if (Math::is_nan(collision_point.x)) {
+			continue;
+		}
+		if (Math::is_equal_approx(collision_point.dot(point), real_t(1.0))) {
+			r_in_bounds = true;
+			return point;
+		}
+		if (collision_point.dot(point) > closest_cos) {
+			closest = collision_point;
+			closest_cos = collision_point.dot(point);
+		}
+	}
+	return closest;
+}
+
+static const Vector3 sample_points[] = {
+	Vector3(1, 0, 0),
+	Vector3(1, 1, 0).normalized(),
+	Vector3(1, 1, 0.2).normalized(),
+	Vector3(1, 1, -0.2).normalized(),
+	Vector3(-1, 0, 0),
+	Vector3(0, -1, 0),
+	Vector3(0.3, 0.8, 0.6).normalized(),
+	Vector3(-0.2, 0.4, 1).normalized(),
+};
+
+TEST_CASE("[Modules][ManyBoneIK][IKKusudama3D] Baked cones match the limit cone resources") {
+	Ref<IKKusudama3D> kusudama = create_three_cone_kusudama();
+	for (const Vector3 &point : sample_points) {
+		bool is_expected_in_bounds = false;
+		Vector3 expected = get_resource_point_in_limits(kusudama, point, is_expected_in_bounds);
+
+		double bounds = 0;
+		Vector3 result = kusudama->get_local_point_in_limits(point, bounds);
+		CHECK_EQ(bounds > 0, is_expected_in_bounds);
+		CHECK(result.is_equal_approx(expected));
+	}
+}
+
+TEST_CASE("[Modules][ManyBoneIK][IKKusudama3D] Snapping to the baked cones matches snapping to the cone resources") {
+	Ref<IKKusudama3D> kusudama = create_three_cone_kusudama();
+	Ref<IKNode3D> limiting_axes;
+	limiting_axes.instantiate();
+	limiting_axes->set_global_transform(Transform3D(Basis(Vector3(0, 0, 1), 0.4), Vector3(0.5, 1, -0.2)));
+	const Transform3D limiting_global = limiting_axes->get_global_transform();
+
+	for (const Vector3 &point : sample_points) {
+		// The bone points at the sample, seen from the constraint, and its direction is its own frame.
+		Ref<IKNode3D> to_set;
+		to_set.instantiate();
+		to_set->set_global_transform(Transform3D(Basis(Quaternion(Vector3(0, 1, 0), limiting_global.basis.xform(point).normalized())), limiting_global.origin));
+		Ref<IKNode3D> bone_direction;
+		bone_direction.instantiate();
+		bone_direction->set_parent(to_set);
+		const Transform3D start = to_set->get_global_transform();
+
+		// What snap_to_orientation_limit did before the cones were baked.
+		Transform3D expected = start;
+		const Vector3 bone_tip = bone_direction->get_global_transform().xform(Vector3(0, 1, 0));
+		bool is_in_bounds = false;
+		const Vector3 in_limits = get_resource_point_in_limits(kusudama, limiting_global.affine_inverse().xform(bone_tip), is_in_bounds);
+		if (!is_in_bounds) {
+			Ref<IKNode3D> expected_node;
+			expected_node.instantiate();
+			expected_node->set_global_transform(start);
+			expected_node->rotate_local_with_global(Quaternion(bone_tip - limiting_global.origin, limiting_global.xform(in_limits) - limiting_global.origin));
+			expected = expected_node->get_global_transform();
+		}
+
+		kusudama->snap_to_orientation_limit(bone_direction, to_set, limiting_axes, 0, 0);
+		CHECK(to_set->get_global_transform().is_equal_approx(expected));
+	}
+}
 } // namespace TestIKKusudama3D
@@ -103,4 +103,43 @@ TEST_CASE("[Modules][IKNode3D] Test local transform calculation") {
 
 	CHECK(node->get_transform() == expected_local_transform);
 }
+
+TEST_CASE("[Modules][IKNode3D] Propagation after repeated changes and reparenting") {
+	Ref<IKNode3D> parent_node;
+	parent_node.instantiate();
+	Ref<IKNode3D> other_parent_node;
+	other_parent_node.instantiate();
+	Ref<IKNode3D> node;
+	node.instantiate();
+	Ref<IKNode3D> child_node;
+	child_node.instantiate();
+	node->set_parent(parent_node);
+	child_node->set_parent(node);
+
+	Transform3D local_transform;
+	local_transform.origin = Vector3(0.0, 1.0, 0.0);
+	node->set_transform(local_transform);
+	child_node->set_transform(local_transform);
+
+	// The second change finds the subtree already dirty and must still be picked up.
+	Transform3D parent_transform;
+	parent_transform.origin = Vector3(1.0, 0.0, 0.0);
+	parent_node->set_transform(parent_transform);
+	parent_transform.origin = Vector3(2.0, 0.0, 0.0);
+	parent_node->set_transform(parent_transform);
+	CHECK(child_node->get_global_transform().origin.is_equal_approx(Vector3(2.0, 2.0, 0.0)));
+
+	parent_transform.origin = Vector3(3.0, 0.0, 0.0);
+	parent_node->set_transform(parent_transform);
+	CHECK(node->get_global_transform().origin.is_equal_approx(Vector3(3.0, 1.0, 0.0)));
+	CHECK(child_node->get_global_transform().origin.is_equal_approx(Vector3(3.0, 2.0, 0.0)));
+
+	// A reparented node follows its new parent only.
+	node->set_parent(other_parent_node);
+	CHECK(node->get_parent() == other_parent_node);
+	CHECK(child_node->get_global_transform().origin.is_equal_approx(Vector3(0.0, 2.0, 0.0)));
+	parent_transform.origin = Vector3(4.0, 0.0, 0.0);
+	parent_node->set_transform(parent_transform);
+	CHECK(child_node->get_global_transform().origin.is_equal_approx(Vector3(0.0, 2.0, 0.0)));
+}
 } // namespace TestIKNode3D
@@ -0,0 +1,63 @@
+/**************************************************************************/
+/*  test_ik_rigid_transform_3d.h                                          */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#pragma once
+
+#include "core/math/math_funcs.h"
+#include "modules/many_bone_ik/src/math/ik_rigid_transform_3d.h"
+#include "tests/test_macros.h"
+
+namespace TestIKRigidTransform3D {
+
+TEST_CASE("[Modules][IKRigidTransform3D] Composition matches Transform3D") {
+	IKRigidTransform3D parent(Quaternion(Vector3(0, 1, 0), Math::PI / 3.0), Vector3(1, 2, 3), 2.0);
+	IKRigidTransform3D child(Quaternion(Vector3(1, 0, 0), -Math::PI / 4.0), Vector3(-2, 0.5, 1));
+
+	Transform3D expected = parent.to_transform() * child.to_transform();
+	IKRigidTransform3D composed = parent * child;
+	CHECK(composed.to_transform().is_equal_approx(expected));
+
+	Vector3 point(0.25, -1, 4);
+	CHECK(composed.xform(point).is_equal_approx(expected.xform(point)));
+	CHECK(composed.get_column(Vector3::AXIS_Y).is_equal_approx(expected.basis.get_column(Vector3::AXIS_Y)));
+}
+
+TEST_CASE("[Modules][IKRigidTransform3D] Inverse and round trip") {
+	IKRigidTransform3D transform(Quaternion(Vector3(1, 1, 0).normalized(), 0.7), Vector3(3, -1, 2), 0.5);
+	Vector3 point(1, 2, 3);
+	CHECK(transform.xform_inv(transform.xform(point)).is_equal_approx(point));
+	CHECK(transform.inverse().xform(transform.xform(point)).is_equal_approx(point));
+
+	IKRigidTransform3D round_trip(transform.to_transform());
+	CHECK(round_trip.rotation.is_equal_approx(transform.rotation));
+	CHECK(round_trip.origin.is_equal_approx(transform.origin));
+	CHECK(Math::is_equal_approx(round_trip.scale, transform.scale));
+}
+} // namespace TestIKRigidTransform3D
@@ -0,0 +1,580 @@
+/**************************************************************************/
+/*  test_many_bone_ik_3d.h                                                */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#pragma once
+
+#include "core/os/os.h"
+#include "modules/many_bone_ik/src/ik_solver_rig_3d.h"
+#include "modules/many_bone_ik/src/many_bone_ik_3d.h"
+#include "modules/many_bone_ik/src/many_bone_ik_3d_server.h"
+#include "modules/many_bone_ik/src/many_bone_ik_3d_state.h"
+#include "scene/3d/skeleton_3d.h"
+#include "scene/main/scene_tree.h"
+#include "scene/main/window.h"
+#include "tests/test_macros.h"
+
+namespace TestManyBoneIK3D {
+
+// Runs the modification the way Skeleton3D does, so each test decides when a node solves.
+class ManualManyBoneIK3D : public ManyBoneIK3D {
+public:
+	void run_modification() {
+		_process_modification(0.0);
+		emit_signal(SNAME("modification_processed"));
+	}
+
+	// A hidden node compiles its rig but does not solve, so it has not solved this frame yet.
+	void build_rig() {
+		hide();
+		run_modification();
+		show();
+	}
+};
+
+// A straight chain along +Y with one unit between joints.
+static Skeleton3D *create_chain_skeleton(int32_t p_bone_count) {
+	Skeleton3D *skeleton = memnew(Skeleton3D);
+	for (int32_t bone_i = 0; bone_i < p_bone_count; bone_i++) {
+		skeleton->add_bone(vformat("Bone%d", bone_i));
+		if (bone_i > 0) {
+			skeleton->set_bone_parent(bone_i, bone_i - 1);
+			skeleton->set_bone_rest(bone_i, Transform3D(Basis(), Vector3(0, 1, 0)));
+		}
+	}
+	skeleton->reset_bone_poses();
+	SceneTree::get_singleton()->get_root()->add_child(skeleton);
+	return skeleton;
+}
+
+static Node3D *create_target(Skeleton3D *p_skeleton, const String &p_name, const Vector3 &p_position) {
+	Node3D *target = memnew(Node3D);
+	target->set_name(p_name);
+	target->set_position(p_position);
+	p_skeleton->add_child(target);
+	return target;
+}
+
+static ManualManyBoneIK3D *create_ik(Skeleton3D *p_skeleton, bool p_batched = false) {
+	ManualManyBoneIK3D *ik = memnew(ManualManyBoneIK3D);
+	ik->set_name("ManyBoneIK3D");
+	ik->set_synchronous_rebuild(true);
+	ik->set_batched_solve(p_batched);
+	p_skeleton->add_child(ik);
+	return ik;
+}
+
+// Translation only pins give every pin a single heading.
+static void add_pin(ManyBoneIK3D *p_ik, const String &p_bone, Node3D *p_target) {
+	int32_t pin_i = p_ik->get_pin_count();
+	p_ik->set_pin_count(pin_i + 1);
+	p_ik->set_pin_bone_name(pin_i, p_bone);
+	p_ik->set_pin_target_node_path(pin_i, p_ik->get_path_to(p_target));
+	p_ik->set_pin_direction_priorities(pin_i, Vector3());
+}
+
+// A chain skeleton in the scene tree with a ManualManyBoneIK3D on it. The skeleton, and so the node
+// and every target, is freed when the test leaves scope, including after a failed REQUIRE.
+struct IKChain {
+	Skeleton3D *skeleton = nullptr;
+	ManualManyBoneIK3D *ik = nullptr;
+
+	explicit IKChain(int32_t p_bone_count = 4, bool p_batched = false) {
+		skeleton = create_chain_skeleton(p_bone_count);
+		ik = create_ik(skeleton, p_batched);
+	}
+	~IKChain() {
+		memdelete(skeleton);
+	}
+
+	// Adds a bone p_offset away from its parent, or from the skeleton origin for a new root.
+	BoneId add_bone(const String &p_name, BoneId p_parent, const Vector3 &p_offset) {
+		BoneId bone = skeleton->get_bone_count();
+		skeleton->add_bone(p_name);
+		if (p_parent != -1) {
+			skeleton->set_bone_parent(bone, p_parent);
+		}
+		skeleton->set_bone_rest(bone, Transform3D(Basis(), p_offset));
+		skeleton->reset_bone_poses();
+		return bone;
+	}
+
+	// Pins p_bone to a new target named after it.
+	Node3D *pin(const String &p_bone, const Vector3 &p_position) {
+		Node3D *target = create_target(skeleton, p_bone + "Target", p_position);
+		add_pin(ik, p_bone, target);
+		return target;
+	}
+};
+
+static void check_same_pose(const Skeleton3D *p_expected, const Skeleton3D *p_skeleton) {
+	REQUIRE(p_expected->get_bone_count() == p_skeleton->get_bone_count());
+	for (int32_t bone_i = 0; bone_i < p_expected->get_bone_count(); bone_i++) {
+		CHECK(p_skeleton->get_bone_pose_rotation(bone_i).is_equal_approx(p_expected->get_bone_pose_rotation(bone_i)));
+		CHECK(p_skeleton->get_bone_pose_position(bone_i).is_equal_approx(p_expected->get_bone_pose_position(bone_i)));
+	}
+}
+
+TEST_CASE("[SceneTree][Modules][ManyBoneIK][ManyBoneIK3D] One iteration turns each bone by its full clamped rotation") {
+	IKChain chain;
+	chain.ik->set_iterations_per_frame(1);
+	chain.ik->set_default_damp(0.1);
+	// A pinned root puts the rest of the chain in a segment that does not translate, so the damp limits its bones.
+	chain.pin("Bone0", Vector3());
+	chain.pin("Bone3", Vector3(5, 3, 0));
+	chain.ik->run_modification();
+
+	// Both middle bones would need about a right angle, so each step is clamped to the damp.
+	// A step blended back toward the pose it started from would turn them by less.
+	for (int32_t bone_i = 1; bone_i <= 2; bone_i++) {
+		const Quaternion rotation = chain.skeleton->get_bone_pose_rotation(bone_i);
+		const double angle = 2.0 * Math::acos(CLAMP(double(Math::abs(rotation.w)), 0.0, 1.0));
+		CHECK(Math::abs(angle - 0.1) < 1e-4);
+	}
+}
+
+TEST_CASE("[SceneTree][Modules][ManyBoneIK][ManyBoneIK3DState] A baked state rebuilds the rig of a fresh node") {
+	IKChain baked;
+	baked.pin("Bone3", Vector3(1, 2, 0));
+	baked.ik->run_modification();
+	Ref<ManyBoneIK3DState> state = baked.ik->bake_state();
+	REQUIRE(state.is_valid());
+	CHECK_FALSE(state->is_empty());
+
+	// The fresh node has no pins of its own, so only the state can make it solve.
+	IKChain fresh;
+	create_target(fresh.skeleton, "Bone3Target", Vector3(1, 2, 0));
+	fresh.ik->set_state(state);
+	fresh.ik->run_modification();
+	// A rig applied from a state has no IKBone3D graph behind it.
+	CHECK(fresh.ik->get_bone_list().is_empty());
+	CHECK(fresh.ik->get_last_iteration_count() == baked.ik->get_last_iteration_count());
+	check_same_pose(baked.skeleton, fresh.skeleton);
+
+	// A skeleton with another topology hash rejects the state, and the node compiles its own settings instead.
+	IKChain other(5);
+	other.pin("Bone3", Vector3(1, 2, 0));
+	other.ik->set_state(state);
+	ERR_PRINT_OFF;
+	other.ik->run_modification();
+	ERR_PRINT_ON;
+	CHECK_FALSE(other.ik->get_bone_list().is_empty());
+	CHECK(other.ik->get_last_iteration_count() > 0);
+}
+
+TEST_CASE("[SceneTree][Modules][ManyBoneIK][IKSolverRig3D] Warm start blends the previous solution into the incoming pose") {
+	IKChain chain;
+	chain.pin("Bone3", Vector3(1, 2, 0));
+	Skeleton3D *skeleton = chain.skeleton;
+	ManualManyBoneIK3D *ik = chain.ik;
+	ik->run_modification();
+	Ref<ManyBoneIK3DState> state = ik->bake_state();
+	REQUIRE(state.is_valid());
+
+	IKSolverRig3D rig;
+	REQUIRE(rig.build_from_state(state.ptr(), skeleton));
+	rig.read_effector_targets(skeleton->get_global_transform().affine_inverse(), ik);
+	skeleton->reset_bone_poses();
+	rig.read_skeleton_poses(skeleton);
+	rig.solve(false);
+	rig.write_skeleton_poses(skeleton);
+	Vector<Quaternion> solved_rotations;
+	Vector<Vector3> solved_positions;
+	for (int32_t bone_i = 0; bone_i < skeleton->get_bone_count(); bone_i++) {
+		solved_rotations.push_back(skeleton->get_bone_pose_rotation(bone_i));
+		solved_positions.push_back(skeleton->get_bone_pose_position(bone_i));
+	}
+	CHECK_FALSE(solved_rotations[1].is_equal_approx(Quaternion()));
+
+	// The animation hands the rest pose in again, and the rig starts from a blend of it and its last solution.
+	const real_t warm_start = 0.25;
+	skeleton->reset_bone_poses();
+	rig.read_skeleton_poses(skeleton, warm_start);
+	rig.write_skeleton_poses(skeleton);
+	for (int32_t bone_i = 0; bone_i < skeleton->get_bone_count(); bone_i++) {
+		const Transform3D rest = skeleton->get_bone_rest(bone_i);
+		CHECK(skeleton->get_bone_pose_rotation(bone_i).is_equal_approx(rest.basis.get_rotation_quaternion().slerp(solved_rotations[bone_i], warm_start)));
+		CHECK(skeleton->get_bone_pose_position(bone_i).is_equal_approx(rest.origin.lerp(solved_positions[bone_i], warm_start)));
+	}
+
+	// Without warm start the incoming pose replaces the previous solution.
+	skeleton->reset_bone_poses();
+	rig.read_skeleton_poses(skeleton);
+	rig.write_skeleton_poses(skeleton);
+	for (int32_t bone_i = 0; bone_i < skeleton->get_bone_count(); bone_i++) {
+		CHECK(skeleton->get_bone_pose_rotation(bone_i).is_equal_approx(skeleton->get_bone_rest(bone_i).basis.get_rotation_quaternion()));
+	}
+}
+
+TEST_CASE("[SceneTree][Modules][ManyBoneIK][IKSolverRig3D] Input changes are measured against the sleep epsilon") {
+	IKChain chain;
+	Node3D *target = chain.pin("Bone3", Vector3(1, 2, 0));
+	Skeleton3D *skeleton = chain.skeleton;
+	ManualManyBoneIK3D *ik = chain.ik;
+	ik->run_modification();
+	Ref<ManyBoneIK3DState> state = ik->bake_state();
+	REQUIRE(state.is_valid());
+
+	const real_t epsilon = 1e-3;
+	const Transform3D skeleton_global_inverse = skeleton->get_global_transform().affine_inverse();
+	IKSolverRig3D rig;
+	REQUIRE(rig.build_from_state(state.ptr(), skeleton));
+	// Nothing has been read yet, so there is nothing to compare against.
+	CHECK_FALSE(rig.is_input_unchanged(skeleton, epsilon));
+
+	skeleton->reset_bone_poses();
+	rig.read_effector_targets(skeleton_global_inverse, ik);
+	rig.read_skeleton_poses(skeleton);
+	CHECK(rig.is_input_unchanged(skeleton, epsilon));
+
+	skeleton->set_bone_pose_position(2, Vector3(0, 1 + epsilon * 0.5, 0));
+	CHECK(rig.is_input_unchanged(skeleton, epsilon));
+	skeleton->set_bone_pose_position(2, Vector3(0, 1 + epsilon * 2.0, 0));
+	CHECK_FALSE(rig.is_input_unchanged(skeleton, epsilon));
+	skeleton->reset_bone_poses();
+	skeleton->set_bone_pose_rotation(1, Quaternion(Vector3(0, 0, 1), 0.01));
+	CHECK_FALSE(rig.is_input_unchanged(skeleton, epsilon));
+	skeleton->reset_bone_poses();
+	CHECK(rig.is_input_unchanged(skeleton, epsilon));
+
+	target->set_position(Vector3(1, 2 + epsilon * 2.0, 0));
+	rig.read_effector_targets(skeleton_global_inverse, ik);
+	CHECK_FALSE(rig.is_input_unchanged(skeleton, epsilon));
+	target->set_position(Vector3(1, 2, 0));
+	rig.read_effector_targets(skeleton_global_inverse, ik);
+	CHECK(rig.is_input_unchanged(skeleton, epsilon));
+}
+
+TEST_CASE("[SceneTree][Modules][ManyBoneIK][ManyBoneIK3D] A sleeping node re-emits its last solution until its input changes") {
+	IKChain chain;
+	chain.pin("Bone3", Vector3(1, 2, 0));
+	Skeleton3D *skeleton = chain.skeleton;
+	ManualManyBoneIK3D *ik = chain.ik;
+	ik->set_sleep_mode(true);
+	ik->run_modification();
+	CHECK(ik->get_skipped_frame_count() == 0);
+	Vector<Quaternion> solved_rotations;
+	for (int32_t bone_i = 0; bone_i < skeleton->get_bone_count(); bone_i++) {
+		solved_rotations.push_back(skeleton->get_bone_pose_rotation(bone_i));
+	}
+
+	// The animation hands in the same pose again, and the target has not moved.
+	skeleton->reset_bone_poses();
+	ik->run_modification();
+	CHECK(ik->get_skipped_frame_count() == 1);
+	CHECK(ik->get_last_iteration_count() == 0);
+	for (int32_t bone_i = 0; bone_i < skeleton->get_bone_count(); bone_i++) {
+		CHECK(skeleton->get_bone_pose_rotation(bone_i).is_equal_approx(solved_rotations[bone_i]));
+	}
+
+	skeleton->reset_bone_poses();
+	skeleton->set_bone_pose_rotation(1, Quaternion(Vector3(0, 0, 1), 0.1));
+	ik->run_modification();
+	CHECK(ik->get_skipped_frame_count() == 1);
+	CHECK(ik->get_last_iteration_count() > 0);
+}
+
+TEST_CASE("[SceneTree][Modules][ManyBoneIK][ManyBoneIK3D] Packed pin and constraint data round-trip") {
+	IKChain chain;
+	chain.pin("Bone0", Vector3());
+	chain.pin("Bone3", Vector3(1, 2, 0));
+	ManualManyBoneIK3D *ik = chain.ik;
+	ik->set_pin_weight(1, 0.5);
+	ik->set_pin_motion_propagation_factor(1, 0.25);
+	ik->set_pin_direction_priorities(1, Vector3(0.2, 0.0, 0.4));
+	ik->set("constraint_count", 2);
+	ik->set("constraints/0/bone_name", "Bone1");
+	ik->set("constraints/1/bone_name", "Bone2");
+	ik->set_joint_twist(0, Vector2(0.1, 0.5));
+	ik->set_kusudama_open_cone_count(0, 2);
+	ik->set_kusudama_open_cone_center(0, 0, Vector3(0, 1, 0));
+	ik->set_kusudama_open_cone_radius(0, 0, 0.3);
+	ik->set_kusudama_open_cone_center(0, 1, Vector3(1, 0, 0));
+	ik->set_kusudama_open_cone_radius(0, 1, 0.2);
+
+	// The second constraint saves the defaults its rig computed, the first the transforms set on it.
+	ik->build_rig();
+	const Transform3D bone_direction(Basis(Vector3(0, 0, 1), 0.3), Vector3());
+	const Transform3D orientation(Basis(Vector3(1, 0, 0), 0.2), Vector3());
+	const Transform3D twist(Basis(Vector3(0, 1, 0), 0.4), Vector3());
+	ik->set_direction_transform_of_bone(0, bone_direction);
+	ik->set_orientation_transform_of_constraint(0, orientation);
+	ik->set_twist_transform_of_constraint(0, twist);
+
+	const Dictionary pin_data = ik->get("pin_data");
+	const Dictionary constraint_data = ik->get("constraint_data");
+	ManualManyBoneIK3D *loaded_ik = memnew(ManualManyBoneIK3D);
+	loaded_ik->set_synchronous_rebuild(true);
+	loaded_ik->set("pin_data", pin_data);
+	loaded_ik->set("constraint_data", constraint_data);
+	// Whether the node saves packed data is its own property, which loading does not change.
+	CHECK_FALSE(loaded_ik->get_packed_storage());
+
+	REQUIRE(loaded_ik->get_pin_count() == ik->get_pin_count());
+	for (int32_t pin_i = 0; pin_i < ik->get_pin_count(); pin_i++) {
+		CHECK(loaded_ik->get_pin_bone_name(pin_i) == ik->get_pin_bone_name(pin_i));
+		CHECK(loaded_ik->get_pin_target_node_path(pin_i) == ik->get_pin_target_node_path(pin_i));
+		CHECK(loaded_ik->get_pin_weight(pin_i) == doctest::Approx(ik->get_pin_weight(pin_i)));
+		CHECK(loaded_ik->get_pin_motion_propagation_factor(pin_i) == doctest::Approx(ik->get_pin_motion_propagation_factor(pin_i)));
+		CHECK(loaded_ik->get_pin_direction_priorities(pin_i).is_equal_approx(ik->get_pin_direction_priorities(pin_i)));
+	}
+	REQUIRE(loaded_ik->get_constraint_count() == ik->get_constraint_count());
+	for (int32_t constraint_i = 0; constraint_i < ik->get_constraint_count(); constraint_i++) {
+		const String bone_name_property = vformat("constraints/%d/bone_name", constraint_i);
+		CHECK(loaded_ik->get(bone_name_property) == ik->get(bone_name_property));
+		CHECK(loaded_ik->get_joint_twist(constraint_i).is_equal_approx(ik->get_joint_twist(constraint_i)));
+		REQUIRE(loaded_ik->get_kusudama_open_cone_count(constraint_i) == ik->get_kusudama_open_cone_count(constraint_i));
+		for (int32_t cone_i = 0; cone_i < ik->get_kusudama_open_cone_count(constraint_i); cone_i++) {
+			CHECK(loaded_ik->get_kusudama_open_cone_center(constraint_i, cone_i).is_equal_approx(ik->get_kusudama_open_cone_center(constraint_i, cone_i)));
+			CHECK(loaded_ik->get_kusudama_open_cone_radius(constraint_i, cone_i) == doctest::Approx(ik->get_kusudama_open_cone_radius(constraint_i, cone_i)));
+		}
+		// The loaded node has no skeleton and no rig, so these come from what was loaded.
+		CHECK(loaded_ik->get_direction_transform_of_bone(constraint_i).is_equal_approx(ik->get_direction_transform_of_bone(constraint_i)));
+		CHECK(loaded_ik->get_orientation_transform_of_constraint(constraint_i).is_equal_approx(ik->get_orientation_transform_of_constraint(constraint_i)));
+		CHECK(loaded_ik->get_twist_transform_of_constraint(constraint_i).is_equal_approx(ik->get_twist_transform_of_constraint(constraint_i)));
+	}
+
+	// Writing the loaded node back out gives the same data.
+	CHECK(Dictionary(loaded_ik->get("pin_data")) == pin_data);
+	CHECK(Dictionary(loaded_ik->get("constraint_data")) == constraint_data);
+
+	// Mismatched arrays are rejected and leave the node as it was.
+	Dictionary broken_pin_data = pin_data.duplicate();
+	broken_pin_data["parameters"] = PackedFloat32Array();
+	Dictionary broken_constraint_data = constraint_data.duplicate();
+	Array broken_transforms = constraint_data["transforms"];
+	broken_transforms = broken_transforms.duplicate();
+	broken_transforms[0] = Vector3();
+	broken_constraint_data["transforms"] = broken_transforms;
+	ERR_PRINT_OFF;
+	loaded_ik->set("pin_data", broken_pin_data);
+	loaded_ik->set("constraint_data", broken_constraint_data);
+	ERR_PRINT_ON;
+	CHECK(loaded_ik->get_pin_count() == ik->get_pin_count());
+	CHECK(Dictionary(loaded_ik->get("constraint_data")) == constraint_data);
+
+	// A rebuild puts the loaded transforms on the bones instead of the defaults.
+	chain.skeleton->add_child(loaded_ik);
+	loaded_ik->build_rig();
+	Ref<IKBone3D> constrained_bone = loaded_ik->find_ik_bone(1);
+	REQUIRE(constrained_bone.is_valid());
+	CHECK(constrained_bone->get_bone_direction_transform()->get_transform().is_equal_approx(bone_direction));
+	CHECK(constrained_bone->get_constraint_orientation_transform()->get_transform().is_equal_approx(orientation));
+	CHECK(constrained_bone->get_constraint_twist_transform()->get_transform().is_equal_approx(twist));
+}
+
+TEST_CASE("[SceneTree][Modules][ManyBoneIK][ManyBoneIK3D] Tolerance mode stops once every effector is close enough") {
+	// The tip already sits on its target, so there is nothing to solve.
+	IKChain reached;
+	reached.pin("Bone3", Vector3(0, 3, 0));
+	reached.ik->set_tolerance_mode(true);
+	reached.ik->run_modification();
+	CHECK(reached.ik->get_last_iteration_count() == 0);
+	CHECK(reached.ik->get_last_position_error() <= reached.ik->get_position_tolerance());
+
+	IKChain tolerant;
+	tolerant.pin("Bone3", Vector3(1, 2, 0));
+	tolerant.ik->set_iterations_per_frame(50);
+	tolerant.ik->set_default_damp(0.5);
+	tolerant.ik->set_tolerance_mode(true);
+	tolerant.ik->set_position_tolerance(0.01);
+	tolerant.ik->run_modification();
+	const int32_t iteration_count = tolerant.ik->get_last_iteration_count();
+	CHECK(iteration_count > 0);
+	CHECK(iteration_count < 50);
+	CHECK(tolerant.ik->get_last_position_error() <= 0.01);
+
+	// Stopping early leaves the pose that running exactly that many iterations gives.
+	IKChain fixed;
+	fixed.pin("Bone3", Vector3(1, 2, 0));
+	fixed.ik->set_iterations_per_frame(iteration_count);
+	fixed.ik->set_default_damp(0.5);
+	fixed.ik->run_modification();
+	CHECK(fixed.ik->get_last_iteration_count() == iteration_count);
+	check_same_pose(fixed.skeleton, tolerant.skeleton);
+}
+
+// Pins the root and the tip, and limits Bone2 to a single cone.
+static void add_weighted_pins_and_cone(IKChain &r_chain, real_t p_tip_weight, const Vector3 &p_tip_priorities, real_t p_cone_radius) {
+	r_chain.pin("Bone0", Vector3());
+	r_chain.pin("Bone3", Vector3(1, 2, 0));
+	r_chain.ik->set_pin_weight(1, p_tip_weight);
+	r_chain.ik->set_pin_direction_priorities(1, p_tip_priorities);
+	r_chain.ik->set("constraint_count", 1);
+	r_chain.ik->set("constraints/0/bone_name", "Bone2");
+	r_chain.ik->set_kusudama_open_cone_count(0, 1);
+	r_chain.ik->set_kusudama_open_cone_center(0, 0, Vector3(0, 1, 0));
+	r_chain.ik->set_kusudama_open_cone_radius(0, 0, p_cone_radius);
+}
+
+TEST_CASE("[SceneTree][Modules][ManyBoneIK][ManyBoneIK3D] Weight and cone edits patch the rig without rebuilding it") {
+	IKChain patched;
+	add_weighted_pins_and_cone(patched, 1.0, Vector3(0.2, 0.0, 0.2), 0.5);
+	patched.ik->build_rig();
+	const Ref<IKBone3D> tip_bone = patched.ik->find_ik_bone(3);
+	REQUIRE(tip_bone.is_valid());
+
+	// The priorities keep the same axes, so the tip keeps its heading count.
+	SIGNAL_WATCH(patched.ik, "rig_rebuilt");
+	patched.ik->set_pin_weight(1, 0.5);
+	patched.ik->set_pin_direction_priorities(1, Vector3(0.4, 0.0, 0.1));
+	patched.ik->set_kusudama_open_cone_radius(0, 0, 0.3);
+	patched.ik->run_modification();
+	SIGNAL_CHECK_FALSE("rig_rebuilt");
+	SIGNAL_UNWATCH(patched.ik, "rig_rebuilt");
+	CHECK(patched.ik->find_ik_bone(3).ptr() == tip_bone.ptr());
+	Ref<IKBone3D> constrained_bone = patched.ik->find_ik_bone(2);
+	REQUIRE(constrained_bone.is_valid());
+	REQUIRE(constrained_bone->get_constraint().is_valid());
+	CHECK(constrained_bone->get_constraint()->get_open_cone(0)->get_radius() == doctest::Approx(0.3));
+
+	// A node built with the edited settings from the start solves to the same pose.
+	IKChain rebuilt;
+	add_weighted_pins_and_cone(rebuilt, 0.5, Vector3(0.4, 0.0, 0.1), 0.3);
+	rebuilt.ik->run_modification();
+	CHECK(patched.ik->get_last_iteration_count() == rebuilt.ik->get_last_iteration_count());
+	check_same_pose(rebuilt.skeleton, patched.skeleton);
+}
+
+TEST_CASE("[SceneTree][Modules][ManyBoneIK][ManyBoneIK3D] A background rebuild keeps the old rig solving until it swaps") {
+	IKChain chain;
+	chain.pin("Bone3", Vector3(1, 2, 0));
+	chain.ik->build_rig();
+	REQUIRE_FALSE(chain.ik->find_ik_bone(2)->is_pinned());
+
+	chain.ik->set_synchronous_rebuild(false);
+	chain.pin("Bone2", Vector3(1, 1, 0));
+	SIGNAL_WATCH(chain.ik, "rig_rebuilt");
+	chain.ik->run_modification();
+	CHECK(chain.ik->is_rebuilding_rig());
+	CHECK(chain.ik->get_last_iteration_count() > 0);
+	CHECK_FALSE(chain.ik->find_ik_bone(2)->is_pinned());
+	SIGNAL_CHECK_FALSE("rig_rebuilt");
+
+	// The build is only swapped in by the first modification after the worker finishes.
+	for (int32_t wait_i = 0; wait_i < 1000 && chain.ik->is_rebuilding_rig(); wait_i++) {
+		OS::get_singleton()->delay_usec(1000);
+		chain.ik->run_modification();
+	}
+	REQUIRE_FALSE(chain.ik->is_rebuilding_rig());
+	Array signal_args;
+	signal_args.push_back(Array());
+	SIGNAL_CHECK("rig_rebuilt", signal_args);
+	SIGNAL_UNWATCH(chain.ik, "rig_rebuilt");
+	CHECK(chain.ik->find_ik_bone(2)->is_pinned());
+	CHECK(chain.ik->find_ik_bone(3)->is_pinned());
+}
+
+// A second arm off Bone1 and a second root give the solver sibling segments and independent roots.
+static void add_branches(IKChain &r_chain) {
+	BoneId arm = r_chain.add_bone("Arm0", 1, Vector3(1, 0, 0));
+	arm = r_chain.add_bone("Arm1", arm, Vector3(1, 0, 0));
+	r_chain.add_bone("Arm2", arm, Vector3(1, 0, 0));
+	BoneId prop = r_chain.add_bone("Prop0", -1, Vector3(-2, 0, 0));
+	r_chain.add_bone("Prop1", prop, Vector3(0, 1, 0));
+	r_chain.pin("Bone3", Vector3(1, 2, 0));
+	r_chain.pin("Arm2", Vector3(2, 2, 1));
+	r_chain.pin("Prop1", Vector3(-1, 0.5, 0));
+}
+
+TEST_CASE("[SceneTree][Modules][ManyBoneIK][ManyBoneIK3D] The multithreaded solve matches the single-threaded solve") {
+	IKChain single_threaded;
+	add_branches(single_threaded);
+	IKChain multithreaded;
+	add_branches(multithreaded);
+	multithreaded.ik->set_multithreaded_solve(true);
+
+	// Several frames, so each one starts from the pose the previous one wrote.
+	for (int32_t frame_i = 0; frame_i < 3; frame_i++) {
+		single_threaded.ik->run_modification();
+		multithreaded.ik->run_modification();
+		CHECK(multithreaded.ik->get_last_iteration_count() == single_threaded.ik->get_last_iteration_count());
+		check_same_pose(single_threaded.skeleton, multithreaded.skeleton);
+	}
+}
+
+TEST_CASE("[SceneTree][Modules][ManyBoneIK][ManyBoneIK3DServer] A batched solve matches solving each node on its own") {
+	ManyBoneIK3DServer *server = ManyBoneIK3DServer::get_singleton();
+	REQUIRE(server);
+
+	IKChain direct_chain;
+	direct_chain.pin("Bone3", Vector3(1, 2, 0));
+	IKChain batched_chain(4, true);
+	batched_chain.pin("Bone3", Vector3(1, 2, 0));
+	IKChain direct_branches;
+	add_branches(direct_branches);
+	IKChain batched_branches(4, true);
+	add_branches(batched_branches);
+
+	direct_chain.ik->build_rig();
+	batched_chain.ik->build_rig();
+	direct_branches.ik->build_rig();
+	batched_branches.ik->build_rig();
+	CHECK(server->solve_batch() == 2);
+
+	// The batched nodes only write back the poses the batch solved for them.
+	direct_chain.ik->run_modification();
+	batched_chain.ik->run_modification();
+	direct_branches.ik->run_modification();
+	batched_branches.ik->run_modification();
+	check_same_pose(direct_chain.skeleton, batched_chain.skeleton);
+	check_same_pose(direct_branches.skeleton, batched_branches.skeleton);
+	CHECK(batched_chain.ik->get_last_iteration_count() == direct_chain.ik->get_last_iteration_count());
+	CHECK(batched_branches.ik->get_last_iteration_count() == direct_branches.ik->get_last_iteration_count());
+}
+
+TEST_CASE("[SceneTree][Modules][ManyBoneIK][ManyBoneIK3DServer] Only nodes that run first on their skeleton join a batch") {
+	ManyBoneIK3DServer *server = ManyBoneIK3DServer::get_singleton();
+	REQUIRE(server);
+
+	IKChain reference;
+	reference.pin("Bone3", Vector3(1, 2, 0));
+	IKChain first(4, true);
+	first.pin("Bone3", Vector3(1, 2, 0));
+	// The batch reads every skeleton before its modifiers run, so it cannot see what this modifier would write.
+	IKChain second(4, true);
+	second.skeleton->add_child(memnew(SkeletonModifier3D));
+	second.skeleton->move_child(second.ik, -1);
+	second.pin("Bone3", Vector3(1, 2, 0));
+
+	reference.ik->build_rig();
+	first.ik->build_rig();
+	second.ik->build_rig();
+	CHECK(server->solve_batch() == 1);
+
+	// The earlier modifier writes nothing, so all three nodes solve the same input.
+	reference.ik->run_modification();
+	first.ik->run_modification();
+	second.ik->run_modification();
+	check_same_pose(reference.skeleton, first.skeleton);
+	check_same_pose(reference.skeleton, second.skeleton);
+	CHECK(second.ik->get_last_iteration_count() == reference.ik->get_last_iteration_count());
+}
+
+} // namespace TestManyBoneIK3D
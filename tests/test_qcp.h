@@ -200,4 +200,176 @@ TEST_CASE("[Modules][QCP] 45-degree Rotation around Y AND Translation") {
 	CHECK((translation_qcp - expected_translation_component).length() < epsilon);
 }
 
+TEST_CASE("[Modules][QCP] Span API matches weighted_superpose") {
+	PackedVector3Array moved_points;
+	moved_points.push_back(Vector3(1, 0, 0));
+	moved_points.push_back(Vector3(0, 1, 0));
+	moved_points.push_back(Vector3(0, 0, 1));
+	moved_points.push_back(Vector3(2, -1, 3));
+
+	Quaternion expected_rotation = Quaternion(Vector3(1, 1, 0).normalized(), Math::PI / 3.0);
+	Vector3 expected_translation_component = Vector3(1, -2, 0.5);
+
+	PackedVector3Array target_points;
+	for (int i = 0; i < moved_points.size(); ++i) {
+		target_points.push_back(expected_rotation.xform(moved_points[i]) + expected_translation_component);
+	}
+
+	Vector<double> weights;
+	weights.push_back(0.5);
+	weights.push_back(1.0);
+	weights.push_back(0.25);
+	weights.push_back(2.0);
+
+	double epsilon = 1e-6;
+
+	Array result = QuaternionCharacteristicPolynomial::weighted_superpose(moved_points, target_points, weights, true, epsilon);
+	Quaternion rotation_result = result[0];
+	Vector3 translation_result = result[1];
+
+	QCPScratch scratch;
+	QCPResult span_result = QuaternionCharacteristicPolynomial::superpose(moved_points.ptr(), target_points.ptr(), weights.ptr(), moved_points.size(), true, epsilon, scratch);
+
+	CHECK(Math::abs(Math::abs(span_result.rotation.dot(rotation_result)) - 1.0) < epsilon);
+	CHECK((span_result.translation - translation_result).length() < epsilon);
+	CHECK(Math::abs(Math::abs(span_result.rotation.dot(expected_rotation)) - 1.0) < epsilon);
+	CHECK((span_result.translation - expected_translation_component).length() < epsilon);
+
+	QCPResult uniform_result = QuaternionCharacteristicPolynomial::superpose(moved_points.ptr(), target_points.ptr(), nullptr, moved_points.size(), false, epsilon, scratch);
+	CHECK(uniform_result.translation.is_zero_approx());
+}
+
+TEST_CASE("[Modules][QCP] Refined eigenvalue gives the residual RMSD") {
+	Quaternion expected_rotation = Quaternion(Vector3(0.3, -0.5, 0.2).normalized(), 1.1);
+	Vector<Vector3> moved_points;
+	Vector<Vector3> target_points;
+	Vector<double> weights;
+	for (int i = 0; i < 9; ++i) {
+		Vector3 point = Vector3(Math::sin(i * 1.7), Math::cos(i * 0.4), i * 0.2 - 0.8);
+		Vector3 noise = Vector3(Math::cos(i * 2.3), Math::sin(i * 3.1), 0) * 0.1;
+		moved_points.push_back(point);
+		target_points.push_back(expected_rotation.xform(point) + noise);
+		weights.push_back(0.5 + i % 3);
+	}
+
+	double epsilon = 1e-6;
+	QCPScratch scratch;
+	QCPResult result = QuaternionCharacteristicPolynomial::superpose(moved_points.ptr(), target_points.ptr(), weights.ptr(), moved_points.size(), false, epsilon, scratch);
+
+	double weight_sum = 0;
+	double deviation = 0;
+	for (int i = 0; i < moved_points.size(); ++i) {
+		weight_sum += weights[i];
+		deviation += weights[i] * result.rotation.xform(moved_points[i]).distance_squared_to(target_points[i]);
+	}
+	CHECK(result.rmsd > 0.0);
+	CHECK(Math::abs(result.rmsd * result.rmsd - deviation / weight_sum) < epsilon);
+
+	QCPMoments moments;
+	QuaternionCharacteristicPolynomial::superpose_soa(scratch.moved.view(), scratch.target.view(), scratch.weight.ptr(), moved_points.size(), false, epsilon,
+			QuaternionCharacteristicPolynomial::DEFAULT_EIGENVALUE_PRECISION, QuaternionCharacteristicPolynomial::DEFAULT_MAX_ITERATIONS, &moments);
+	CHECK(Math::abs(QuaternionCharacteristicPolynomial::get_rotated_msd(moments, Basis(result.rotation)) - deviation / weight_sum) < epsilon);
+
+	for (int i = 0; i < moved_points.size(); ++i) {
+		target_points.write[i] = expected_rotation.xform(moved_points[i]);
+	}
+	QCPResult exact_result = QuaternionCharacteristicPolynomial::superpose(moved_points.ptr(), target_points.ptr(), weights.ptr(), moved_points.size(), false, epsilon, scratch);
+	CHECK(exact_result.rmsd < epsilon);
+	CHECK(Math::abs(Math::abs(exact_result.rotation.dot(expected_rotation)) - 1.0) < epsilon);
+}
+
+TEST_CASE("[Modules][QCP] Closed-form small superpositions match the general solve") {
+	double epsilon = 1e-6;
+	Quaternion expected_rotation = Quaternion(Vector3(-0.2, 0.9, 0.4).normalized(), 2.3);
+
+	Vector3 moved_single = Vector3(0.5, -1, 2);
+	Vector3 target_single = expected_rotation.xform(moved_single);
+	double weight_single = 0.7;
+	QCPResult single_result = QuaternionCharacteristicPolynomial::superpose_small(&moved_single, &target_single, &weight_single, 1, false, epsilon);
+	CHECK((single_result.rotation.xform(moved_single) - target_single).length() < epsilon);
+	CHECK(single_result.rmsd < epsilon);
+
+	Vector3 moved[3] = { Vector3(1, 0.2, 0), Vector3(-0.3, 1, 0.5), Vector3(0.1, -0.4, 1) };
+	Vector3 target[3];
+	for (int i = 0; i < 3; ++i) {
+		target[i] = expected_rotation.xform(moved[i]) + Vector3(0.05 * i, -0.1, 0.02);
+	}
+	double weights[3] = { 1.5, 0.5, 1.0 };
+	QCPScratch scratch;
+	for (int count = 2; count <= QuaternionCharacteristicPolynomial::MAX_SMALL_COUNT; ++count) {
+		for (int translate = 0; translate < 2; ++translate) {
+			QCPResult small_result = QuaternionCharacteristicPolynomial::superpose_small(moved, target, weights, count, translate, epsilon);
+			QCPResult general_result = QuaternionCharacteristicPolynomial::superpose(moved, target, weights, count, translate, epsilon, scratch);
+			CHECK(Math::abs(small_result.rmsd - general_result.rmsd) < epsilon);
+			if (count > 2 || !translate) {
+				// A centered pair leaves the spin about its own axis free, so only the residual is unique there.
+				CHECK(Math::abs(Math::abs(small_result.rotation.dot(general_result.rotation)) - 1.0) < epsilon);
+				CHECK((small_result.translation - general_result.translation).length() < epsilon);
+			}
+		}
+	}
+}
+
+TEST_CASE("[Modules][QCP] Structure-of-arrays moments match per-heading moments") {
+	const int count = 13;
+	QCPHeadingBuffer moved;
+	QCPHeadingBuffer target;
+	moved.resize(count);
+	target.resize(count);
+	LocalVector<double> weights;
+	weights.resize(count);
+	QCPMoments per_heading;
+	for (int i = 0; i < count; ++i) {
+		moved.set(i, Vector3(Math::sin(i * 0.7), Math::cos(i * 1.3), i * 0.25 - 1.0));
+		target.set(i, Vector3(i * -0.5, Math::sin(i * 0.3) * 2.0, Math::cos(i * 0.9)));
+		weights[i] = 0.25 + (i % 4) * 0.5;
+		per_heading.add(weights[i], target.get(i), moved.get(i));
+	}
+
+	QCPMoments soa;
+	QuaternionCharacteristicPolynomial::superpose_soa(moved.view(), target.view(), weights.ptr(), count, false, 1e-6, QuaternionCharacteristicPolynomial::DEFAULT_EIGENVALUE_PRECISION, QuaternionCharacteristicPolynomial::DEFAULT_MAX_ITERATIONS, &soa);
+
+	double epsilon = 1e-9;
+	CHECK(Math::abs(soa.weight_sum - per_heading.weight_sum) < epsilon);
+	CHECK(Math::abs(soa.moved_squares - per_heading.moved_squares) < epsilon);
+	CHECK(Math::abs(soa.target_squares - per_heading.target_squares) < epsilon);
+	for (int axis = 0; axis < 3; ++axis) {
+		CHECK(Math::abs(soa.moved_sum[axis] - per_heading.moved_sum[axis]) < epsilon);
+		CHECK(Math::abs(soa.target_sum[axis] - per_heading.target_sum[axis]) < epsilon);
+	}
+	for (int element = 0; element < 9; ++element) {
+		CHECK(Math::abs(soa.covariance[element] - per_heading.covariance[element]) < epsilon);
+	}
+}
+
+TEST_CASE("[Modules][QCP] Aggregated symmetric pairs match per-heading moments") {
+	Vector3 position_target = Vector3(0.3, -1, 2);
+	Vector3 position_moved = Vector3(1, 2, -0.4);
+	Vector3 target_offset = Vector3(0.5, 0.1, -0.7);
+	Vector3 moved_offset = Vector3(-0.2, 0.8, 0.3);
+	double weight = 0.7;
+
+	QCPMoments aggregated;
+	aggregated.add(1.0, position_target, position_moved);
+	aggregated.add_symmetric_pair(weight, position_target, target_offset, position_moved, moved_offset);
+
+	Vector3 moved[3] = { position_moved, position_moved + moved_offset, position_moved - moved_offset };
+	Vector3 target[3] = { position_target, position_target + target_offset, position_target - target_offset };
+	double weights[3] = { 1.0, weight, weight };
+	QCPMoments per_heading;
+	QCPResult small_result = QuaternionCharacteristicPolynomial::superpose_small(moved, target, weights, 3, false, 1e-6, QuaternionCharacteristicPolynomial::DEFAULT_EIGENVALUE_PRECISION, QuaternionCharacteristicPolynomial::DEFAULT_MAX_ITERATIONS, &per_heading);
+
+	double epsilon = 1e-9;
+	CHECK(Math::abs(aggregated.weight_sum - per_heading.weight_sum) < epsilon);
+	CHECK(Math::abs(aggregated.moved_squares - per_heading.moved_squares) < epsilon);
+	CHECK(Math::abs(aggregated.target_squares - per_heading.target_squares) < epsilon);
+	for (int element = 0; element < 9; ++element) {
+		CHECK(Math::abs(aggregated.covariance[element] - per_heading.covariance[element]) < epsilon);
+	}
+
+	QCPResult aggregated_result = QuaternionCharacteristicPolynomial::superpose_moments(aggregated, false, 1e-6);
+	CHECK(Math::abs(Math::abs(aggregated_result.rotation.dot(small_result.rotation)) - 1.0) < 1e-6);
+	CHECK(Math::abs(aggregated_result.rmsd - small_result.rmsd) < 1e-6);
+}
+
 } // namespace TestQCP